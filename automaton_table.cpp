@@ -0,0 +1,961 @@
+#include <automaton_table.h>
+
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <iterator>
+#include <map>
+#include <set>
+
+namespace tusur
+{
+namespace compilers
+{
+
+namespace
+{
+
+constexpr std::string_view TableFormat = "lab1c-automaton 1";
+constexpr size_t ByteCount = 256;
+
+// Объединить в классы байты, столбцы которых совпадают во всех состояниях и для всех вершин стека
+void CompactByteClasses(TransitionTable& table)
+{
+    const size_t rows = table.states.size() * table.TopCount();
+    std::vector<size_t> representative; // старый класс-представитель каждого нового класса
+    std::vector<std::uint8_t> newClass(table.classCount);
+    for( size_t cls = 0; cls < table.classCount; ++cls )
+    {
+        auto same = std::find_if(representative.begin(), representative.end(), [&](size_t other)
+            {
+                for( size_t row = 0; row < rows; ++row )
+                {
+                    if( !(table.entries[row * table.classCount + cls] == table.entries[row * table.classCount + other]) )
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            });
+        newClass[cls] = static_cast<std::uint8_t>(same - representative.begin());
+        if( same == representative.end() )
+        {
+            representative.push_back(cls);
+        }
+    }
+
+    std::vector<TableEntry> entries;
+    entries.reserve(rows * representative.size());
+    for( size_t row = 0; row < rows; ++row )
+    {
+        for( size_t cls : representative )
+        {
+            entries.push_back(std::move(table.entries[row * table.classCount + cls]));
+        }
+    }
+    for( auto& cls : table.byteClass )
+    {
+        cls = newClass[cls];
+    }
+    table.entries = std::move(entries);
+    table.classCount = representative.size();
+}
+
+std::vector<bool> ReachableStates(TransitionTable const& table)
+{
+    std::vector<bool> reachable(table.states.size(), false);
+    const size_t rowSize = table.TopCount() * table.classCount;
+    std::vector<size_t> queue{ static_cast<size_t>(table.start) };
+    reachable[table.start] = true;
+    while( !queue.empty() )
+    {
+        const size_t state = queue.back();
+        queue.pop_back();
+        for( size_t i = state * rowSize; i < (state + 1) * rowSize; ++i )
+        {
+            const int next = table.entries[i].next;
+            if( next != TableEntry::NoState && !reachable[next] )
+            {
+                reachable[next] = true;
+                queue.push_back(next);
+            }
+        }
+    }
+    return reachable;
+}
+
+// Переход без учета следующего состояния: для начального разбиения
+TableEntry EntryShape(TableEntry const& entry)
+{
+    TableEntry shape = entry;
+    shape.next = entry.next == TableEntry::NoState ? TableEntry::NoState : 0;
+    return shape;
+}
+
+bool SameSignature(TransitionTable const& table, size_t lhs, size_t rhs)
+{
+    if( table.isFinal[lhs] != table.isFinal[rhs] || table.finalizerActions[lhs] != table.finalizerActions[rhs] )
+    {
+        return false;
+    }
+    const size_t rowSize = table.TopCount() * table.classCount;
+    for( size_t i = 0; i < rowSize; ++i )
+    {
+        if( !(EntryShape(table.entries[lhs * rowSize + i]) == EntryShape(table.entries[rhs * rowSize + i])) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Разбиение достижимых состояний на классы неразличимых алгоритмом Хопкрофта.
+// Возвращает номер класса каждого состояния, у недостижимых TableEntry::NoState
+std::vector<int> EquivalenceClasses(TransitionTable const& table, std::vector<bool> const& reachable)
+{
+    const size_t stateCount = table.states.size();
+    const size_t symbolCount = table.TopCount() * table.classCount; // вершина стека и класс байта
+
+    std::vector<int> blockOf(stateCount, TableEntry::NoState);
+    std::vector<std::vector<size_t>> blocks;
+    for( size_t state = 0; state < stateCount; ++state )
+    {
+        if( !reachable[state] )
+        {
+            continue;
+        }
+        auto block = std::find_if(blocks.begin(), blocks.end(), [&](auto const& members)
+            {
+                return SameSignature(table, members.front(), state);
+            });
+        if( block == blocks.end() )
+        {
+            blocks.emplace_back();
+            block = blocks.end() - 1;
+        }
+        block->push_back(state);
+        blockOf[state] = static_cast<int>(block - blocks.begin());
+    }
+
+    // Обратные переходы: по символу и целевому состоянию - откуда в него приходят
+    std::vector<std::vector<std::vector<size_t>>> inverse(symbolCount, std::vector<std::vector<size_t>>(stateCount));
+    for( size_t state = 0; state < stateCount; ++state )
+    {
+        if( !reachable[state] )
+        {
+            continue;
+        }
+        for( size_t symbol = 0; symbol < symbolCount; ++symbol )
+        {
+            const int next = table.entries[state * symbolCount + symbol].next;
+            if( next != TableEntry::NoState )
+            {
+                inverse[symbol][next].push_back(state);
+            }
+        }
+    }
+
+    std::deque<std::pair<size_t, size_t>> work; // блок-разделитель и символ
+    std::set<std::pair<size_t, size_t>> inWork;
+    for( size_t block = 0; block < blocks.size(); ++block )
+    {
+        for( size_t symbol = 0; symbol < symbolCount; ++symbol )
+        {
+            work.emplace_back(block, symbol);
+            inWork.emplace(block, symbol);
+        }
+    }
+
+    while( !work.empty() )
+    {
+        const auto [splitter, symbol] = work.front();
+        work.pop_front();
+        inWork.erase({ splitter, symbol });
+
+        // Состояния, которые по symbol переходят в splitter, сгруппированные по своим блокам
+        std::map<size_t, std::vector<size_t>> hit;
+        for( size_t target : blocks[splitter] )
+        {
+            for( size_t source : inverse[symbol][target] )
+            {
+                hit[blockOf[source]].push_back(source);
+            }
+        }
+
+        for( auto& [block, members] : hit )
+        {
+            if( members.size() == blocks[block].size() )
+            {
+                continue;
+            }
+
+            const size_t split = blocks.size();
+            std::vector<size_t> rest;
+            std::set<size_t> moved(members.begin(), members.end());
+            for( size_t state : blocks[block] )
+            {
+                if( !moved.count(state) )
+                {
+                    rest.push_back(state);
+                }
+            }
+            for( size_t state : members )
+            {
+                blockOf[state] = static_cast<int>(split);
+            }
+            blocks[block] = std::move(rest);
+            blocks.push_back(std::move(members));
+
+            for( size_t c = 0; c < symbolCount; ++c )
+            {
+                if( inWork.count({ block, c }) )
+                {
+                    work.emplace_back(split, c);
+                    inWork.emplace(split, c);
+                }
+                else
+                {
+                    const size_t smaller = blocks[block].size() <= blocks[split].size() ? block : split;
+                    work.emplace_back(smaller, c);
+                    inWork.emplace(smaller, c);
+                }
+            }
+        }
+    }
+    return blockOf;
+}
+
+std::string QuoteDot(std::string_view text)
+{
+    std::string quoted = "\"";
+    for( char c : text )
+    {
+        if( c == '"' || c == '\\' )
+        {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+std::string DescribeByte(unsigned byte)
+{
+    switch( byte )
+    {
+        case ' ':
+            return "' '";
+        case '\t':
+            return "\\t";
+        case '\n':
+            return "\\n";
+        case '\r':
+            return "\\r";
+        case '\v':
+            return "\\v";
+        case '\f':
+            return "\\f";
+        case '-':
+        case ',':
+        case '[':
+        case ']':
+            return std::string("\\") + static_cast<char>(byte);
+        default:
+            break;
+    }
+    if( byte < 0x20 || byte >= 0x7f )
+    {
+        const char* digits = "0123456789abcdef";
+        return std::string("\\x") + digits[byte >> 4] + digits[byte & 0xf];
+    }
+    return std::string(1, static_cast<char>(byte));
+}
+
+// Множество байт в виде диапазонов: [0-9a-z_]
+std::string DescribeBytes(std::vector<bool> const& bytes)
+{
+    std::string description;
+    for( unsigned begin = 0; begin < ByteCount; )
+    {
+        if( !bytes[begin] )
+        {
+            ++begin;
+            continue;
+        }
+        unsigned end = begin;
+        while( end + 1 < ByteCount && bytes[end + 1] )
+        {
+            ++end;
+        }
+        description += DescribeByte(begin);
+        if( end > begin + 1 )
+        {
+            description += "-";
+        }
+        if( end > begin )
+        {
+            description += DescribeByte(end);
+        }
+        begin = end + 1;
+    }
+    return "[" + description + "]";
+}
+
+std::string DescribeActions(ActionList const& actions)
+{
+    std::string description;
+    for( auto const& action : actions )
+    {
+        if( !description.empty() )
+        {
+            description += ", ";
+        }
+        switch( action.kind )
+        {
+            case TransitionAction::PushSymbol:
+                description += "append";
+                break;
+            case TransitionAction::PushLiteral:
+                description += "append '" + std::string(1, action.symbol) + "'";
+                break;
+            case TransitionAction::CompleteLexeme:
+                description += LexemeTypeToString(action.lexeme);
+                break;
+            case TransitionAction::AddError:
+                description += "error";
+                break;
+        }
+    }
+    return description;
+}
+
+void SaveActions(ActionList const& actions, std::ostream& out)
+{
+    out << actions.size();
+    for( auto const& action : actions )
+    {
+        out << ' ' << static_cast<int>(action.kind);
+        switch( action.kind )
+        {
+            case TransitionAction::PushSymbol:
+                break;
+            case TransitionAction::PushLiteral:
+                out << ' ' << static_cast<int>(static_cast<unsigned char>(action.symbol));
+                break;
+            case TransitionAction::CompleteLexeme:
+                out << ' ' << static_cast<int>(action.lexeme);
+                break;
+            case TransitionAction::AddError:
+                out << ' ' << action.error.size() << ' ' << action.error;
+                break;
+        }
+    }
+}
+
+// Пределы длин списков в таблице: длина читается до самого списка, и испорченная таблица
+// не должна приводить к выделению гигабайт памяти
+constexpr size_t MaxListLength = 1 << 16;   // состояний, действий перехода, символов в push, байт текста ошибки
+constexpr size_t MaxEntryCount = 1 << 20;   // состояний x вершин стека x классов байт
+
+[[noreturn]] void MalformedTable(std::string const& what)
+{
+    throw PdaError("Malformed automaton table: " + what);
+}
+
+template<typename T>
+T Read(std::istream& in, std::string const& what)
+{
+    T value;
+    if( !(in >> value) )
+    {
+        MalformedTable(what);
+    }
+    return value;
+}
+
+void Expect(std::istream& in, std::string const& keyword)
+{
+    if( Read<std::string>(in, keyword) != keyword )
+    {
+        MalformedTable("expected " + keyword);
+    }
+}
+
+size_t ReadIndex(std::istream& in, size_t limit, std::string const& what)
+{
+    const auto value = Read<long long>(in, what);
+    if( value < 0 || static_cast<size_t>(value) >= limit )
+    {
+        MalformedTable(what + " out of range");
+    }
+    return static_cast<size_t>(value);
+}
+
+size_t ReadCount(std::istream& in, size_t limit, std::string const& what)
+{
+    return ReadIndex(in, limit + 1, what);
+}
+
+LexemeType ReadLexemeType(std::istream& in)
+{
+    const auto value = static_cast<LexemeType>(ReadIndex(in, Identifier + 1, "lexeme type"));
+    switch( value )
+    {
+        case OpeningParentheses:
+        case ClosingParentheses:
+        case Assign:
+        case PlusSign:
+        case MultipliesSign:
+        case IntegerNumber:
+        case FloatingPointNumber:
+        case Identifier:
+            return value;
+    }
+    MalformedTable("lexeme type out of range");
+}
+
+ActionList LoadActions(std::istream& in)
+{
+    ActionList actions(ReadCount(in, MaxListLength, "action count"));
+    for( auto& action : actions )
+    {
+        action.kind = static_cast<TransitionAction::Kind>(ReadIndex(in, TransitionAction::AddError + 1, "action kind"));
+        switch( action.kind )
+        {
+            case TransitionAction::PushSymbol:
+                break;
+            case TransitionAction::PushLiteral:
+                action.symbol = static_cast<char>(ReadIndex(in, ByteCount, "pushed symbol"));
+                break;
+            case TransitionAction::CompleteLexeme:
+                action.lexeme = ReadLexemeType(in);
+                break;
+            case TransitionAction::AddError:
+                action.error.resize(ReadCount(in, MaxListLength, "error length"));
+                in.get(); // пробел перед текстом
+                if( !in.read(action.error.data(), action.error.size()) )
+                {
+                    MalformedTable("error text");
+                }
+                break;
+        }
+    }
+    return actions;
+}
+
+} // namespace anonymous
+
+RecordingContext::RecordingContext(char inputSymbol)
+    : inputSymbol_(inputSymbol)
+{}
+
+void RecordingContext::PushToLexeme(char symbol)
+{
+    // Функции перехода кладут в лексему либо считанный символ, либо фиксированный
+    if( symbol == inputSymbol_ )
+    {
+        actions_.push_back({ TransitionAction::PushSymbol, 0, Identifier, {} });
+    }
+    else
+    {
+        actions_.push_back({ TransitionAction::PushLiteral, symbol, Identifier, {} });
+    }
+}
+
+void RecordingContext::CompleteLexeme(LexemeType type)
+{
+    actions_.push_back({ TransitionAction::CompleteLexeme, 0, type, {} });
+}
+
+void RecordingContext::AddError(std::string&& error)
+{
+    actions_.push_back({ TransitionAction::AddError, 0, Identifier, std::move(error) });
+}
+
+ActionList const& RecordingContext::Actions() const
+{
+    return actions_;
+}
+
+size_t TransitionTable::TopCount() const
+{
+    return stackSymbols.size() + 1;
+}
+
+size_t TransitionTable::TopIndex(std::stack<char> const& stack) const
+{
+    if( stack.empty() )
+    {
+        return 0;
+    }
+    const auto position = stackSymbols.find(stack.top());
+    if( position == std::string::npos )
+    {
+        throw PdaError("Stack symbol is not in the transition table");
+    }
+    return position + 1;
+}
+
+TableEntry const& TransitionTable::At(size_t state, size_t top, size_t byteClass) const
+{
+    return entries[(state * TopCount() + top) * classCount + byteClass];
+}
+
+TableEntry& TransitionTable::At(size_t state, size_t top, size_t byteClass)
+{
+    return entries[(state * TopCount() + top) * classCount + byteClass];
+}
+
+int TransitionTable::FindState(std::string const& name) const
+{
+    auto state = std::find(states.begin(), states.end(), name);
+    return state == states.end() ? TableEntry::NoState : static_cast<int>(state - states.begin());
+}
+
+TransitionTable ExtractTable(ProbeAutomaton& pda, std::string const& startState)
+{
+    TransitionTable table;
+    table.states = pda.StateNames();
+    table.start = table.FindState(startState);
+    if( table.start == TableEntry::NoState )
+    {
+        throw PdaError("Invalid starting state");
+    }
+
+    const size_t stateCount = table.states.size();
+    for( auto const& name : table.states )
+    {
+        table.isFinal.push_back(pda.IsFinalState(name));
+        RecordingContext context;
+        std::stack<char> stack;
+        pda.ProbeFinalizer(name, 0, stack, context);
+        table.finalizerActions.push_back(context.Actions());
+    }
+
+    // Переходы по каждому байту для каждой вершины стека. Символы стека, которые кладут переходы,
+    // добавляют новые вершины, пока перебор не перестанет их находить
+    std::vector<std::vector<TableEntry>> byTop;
+    for( size_t top = 0; top < table.TopCount(); ++top )
+    {
+        auto& entries = byTop.emplace_back(stateCount * ByteCount);
+        for( size_t state = 0; state < stateCount; ++state )
+        {
+            for( size_t byte = 0; byte < ByteCount; ++byte )
+            {
+                const char symbol = static_cast<char>(byte);
+                std::stack<char> stack;
+                if( top > 0 )
+                {
+                    stack.push(table.stackSymbols[top - 1]);
+                }
+                RecordingContext context(symbol);
+                const auto next = pda.ProbeTransition(table.states[state], symbol, stack, context);
+
+                auto& entry = entries[state * ByteCount + byte];
+                entry.actions = context.Actions();
+                if( !next )
+                {
+                    continue;
+                }
+                entry.next = table.FindState(*next);
+                if( entry.next == TableEntry::NoState )
+                {
+                    throw PdaError("Transition from " + table.states[state] + " to unregistered state " + *next);
+                }
+
+                // Вершина либо осталась под положенными символами, либо снята
+                std::string after;
+                for( ; !stack.empty(); stack.pop() )
+                {
+                    after.insert(after.begin(), stack.top());
+                }
+                if( top > 0 && !after.empty() && after.front() == table.stackSymbols[top - 1] )
+                {
+                    entry.push = after.substr(1);
+                }
+                else
+                {
+                    entry.pop = top > 0;
+                    entry.push = after;
+                }
+                for( char item : entry.push )
+                {
+                    if( table.stackSymbols.find(item) == std::string::npos )
+                    {
+                        table.stackSymbols += item;
+                    }
+                }
+            }
+        }
+    }
+
+    table.classCount = ByteCount;
+    for( size_t byte = 0; byte < ByteCount; ++byte )
+    {
+        table.byteClass[byte] = static_cast<std::uint8_t>(byte);
+    }
+    for( size_t state = 0; state < stateCount; ++state )
+    {
+        for( auto& entries : byTop )
+        {
+            std::move(entries.begin() + state * ByteCount, entries.begin() + (state + 1) * ByteCount,
+                      std::back_inserter(table.entries));
+        }
+    }
+    CompactByteClasses(table);
+    return table;
+}
+
+StateGraphReport AnalyzeStateGraph(TransitionTable const& table)
+{
+    StateGraphReport report;
+    const auto reachable = ReachableStates(table);
+
+    // Обратный обход от конечных состояний
+    const size_t rowSize = table.TopCount() * table.classCount;
+    std::vector<std::vector<size_t>> predecessors(table.states.size());
+    for( size_t i = 0; i < table.entries.size(); ++i )
+    {
+        if( table.entries[i].next != TableEntry::NoState )
+        {
+            predecessors[table.entries[i].next].push_back(i / rowSize);
+        }
+    }
+    std::vector<bool> live = table.isFinal;
+    std::vector<size_t> queue;
+    for( size_t state = 0; state < table.states.size(); ++state )
+    {
+        if( live[state] )
+        {
+            queue.push_back(state);
+        }
+    }
+    while( !queue.empty() )
+    {
+        const size_t state = queue.back();
+        queue.pop_back();
+        for( size_t previous : predecessors[state] )
+        {
+            if( !live[previous] )
+            {
+                live[previous] = true;
+                queue.push_back(previous);
+            }
+        }
+    }
+
+    for( size_t state = 0; state < table.states.size(); ++state )
+    {
+        if( !reachable[state] )
+        {
+            report.unreachable.push_back(table.states[state]);
+        }
+        if( !live[state] )
+        {
+            report.dead.push_back(table.states[state]);
+        }
+    }
+
+    const auto blockOf = EquivalenceClasses(table, reachable);
+    std::map<int, std::vector<std::string>> groups;
+    for( size_t state = 0; state < table.states.size(); ++state )
+    {
+        if( blockOf[state] != TableEntry::NoState )
+        {
+            groups[blockOf[state]].push_back(table.states[state]);
+        }
+    }
+    for( auto& [block, members] : groups )
+    {
+        if( members.size() > 1 )
+        {
+            report.equivalent.push_back(std::move(members));
+        }
+    }
+    return report;
+}
+
+TransitionTable MinimizeTable(TransitionTable const& table)
+{
+    const auto blockOf = EquivalenceClasses(table, ReachableStates(table));
+
+    // Представитель класса - начальное состояние либо первое из класса
+    std::vector<size_t> representatives;
+    std::map<int, int> newIndex;
+    for( size_t state = 0; state < table.states.size(); ++state )
+    {
+        const int block = blockOf[state];
+        if( block == TableEntry::NoState )
+        {
+            continue;
+        }
+        if( !newIndex.count(block) )
+        {
+            newIndex[block] = static_cast<int>(representatives.size());
+            representatives.push_back(state);
+        }
+        if( static_cast<int>(state) == table.start )
+        {
+            representatives[newIndex[block]] = state;
+        }
+    }
+
+    TransitionTable minimal;
+    minimal.stackSymbols = table.stackSymbols;
+    minimal.byteClass = table.byteClass;
+    minimal.classCount = table.classCount;
+    minimal.start = newIndex[blockOf[table.start]];
+    const size_t rowSize = table.TopCount() * table.classCount;
+    for( size_t state : representatives )
+    {
+        minimal.states.push_back(table.states[state]);
+        minimal.isFinal.push_back(table.isFinal[state]);
+        minimal.finalizerActions.push_back(table.finalizerActions[state]);
+        for( size_t i = state * rowSize; i < (state + 1) * rowSize; ++i )
+        {
+            auto entry = table.entries[i];
+            if( entry.next != TableEntry::NoState )
+            {
+                entry.next = newIndex[blockOf[entry.next]];
+            }
+            minimal.entries.push_back(std::move(entry));
+        }
+    }
+    // После слияния состояний могут совпасть и столбцы байт
+    CompactByteClasses(minimal);
+    return minimal;
+}
+
+std::string FormatTableReport(TransitionTable const& table, StateGraphReport const& report, TransitionTable const& minimal)
+{
+    auto list = [](std::vector<std::string> const& names)
+    {
+        std::string text;
+        for( auto const& name : names )
+        {
+            text += (text.empty() ? "" : ", ") + name;
+        }
+        return text.empty() ? std::string("none") : text;
+    };
+
+    std::string text = "States: " + std::to_string(table.states.size())
+                     + " -> " + std::to_string(minimal.states.size()) + "\n"
+                     + "Stack tops: " + std::to_string(table.TopCount()) + "\n"
+                     + "Byte classes: " + std::to_string(table.classCount)
+                     + " -> " + std::to_string(minimal.classCount) + "\n"
+                     + "Table entries: " + std::to_string(table.states.size() * table.TopCount() * ByteCount)
+                     + " per byte, " + std::to_string(table.entries.size())
+                     + " per class, " + std::to_string(minimal.entries.size()) + " minimized\n"
+                     + "Unreachable states: " + list(report.unreachable) + "\n"
+                     + "Dead states: " + list(report.dead) + "\n"
+                     + "Equivalent states:";
+    if( report.equivalent.empty() )
+    {
+        text += " none";
+    }
+    for( auto const& group : report.equivalent )
+    {
+        text += "\n\t" + list(group);
+    }
+    return text + "\n";
+}
+
+std::string TableToDot(TransitionTable const& table)
+{
+    std::string dot = "digraph automaton {\n"
+                      "    rankdir=LR;\n"
+                      "    \"\" [shape=none];\n"
+                      "    \"\" -> " + QuoteDot(table.states[table.start]) + ";\n";
+    for( size_t state = 0; state < table.states.size(); ++state )
+    {
+        dot += "    " + QuoteDot(table.states[state])
+             + (table.isFinal[state] ? " [shape=doublecircle];\n" : " [shape=circle];\n");
+    }
+
+    for( size_t state = 0; state < table.states.size(); ++state )
+    {
+        for( size_t top = 0; top < table.TopCount(); ++top )
+        {
+            // Классы байт с одинаковым переходом рисуются одним ребром
+            std::vector<bool> drawn(table.classCount, false);
+            for( size_t cls = 0; cls < table.classCount; ++cls )
+            {
+                auto const& entry = table.At(state, top, cls);
+                // Переход, не зависящий от вершины стека, рисуется один раз без вершины
+                if( drawn[cls] || entry.next == TableEntry::NoState || (top > 0 && entry == table.At(state, 0, cls)) )
+                {
+                    continue;
+                }
+                std::vector<bool> bytes(ByteCount, false);
+                for( size_t other = cls; other < table.classCount; ++other )
+                {
+                    if( table.At(state, top, other) == entry && (top == 0 || !(entry == table.At(state, 0, other))) )
+                    {
+                        drawn[other] = true;
+                        for( size_t byte = 0; byte < ByteCount; ++byte )
+                        {
+                            bytes[byte] = bytes[byte] || table.byteClass[byte] == other;
+                        }
+                    }
+                }
+
+                std::string label = DescribeBytes(bytes);
+                if( top > 0 )
+                {
+                    label += " top " + std::string(1, table.stackSymbols[top - 1]);
+                }
+                if( entry.pop )
+                {
+                    label += " pop";
+                }
+                if( !entry.push.empty() )
+                {
+                    label += " push " + entry.push;
+                }
+                if( !entry.actions.empty() )
+                {
+                    label += " / " + DescribeActions(entry.actions);
+                }
+                dot += "    " + QuoteDot(table.states[state]) + " -> " + QuoteDot(table.states[entry.next])
+                     + " [label=" + QuoteDot(label) + "];\n";
+            }
+        }
+    }
+    return dot + "}\n";
+}
+
+void SaveTable(TransitionTable const& table, std::ostream& out)
+{
+    out << TableFormat << "\n"
+        << "states " << table.states.size() << " start " << table.start << "\n";
+    for( size_t state = 0; state < table.states.size(); ++state )
+    {
+        if( table.states[state].empty()
+            || std::any_of(table.states[state].begin(), table.states[state].end(), [](char c){ return std::isspace(static_cast<unsigned char>(c)); }) )
+        {
+            throw PdaError("State name cannot be saved: '" + table.states[state] + "'");
+        }
+        out << table.isFinal[state] << ' ' << table.states[state] << ' ';
+        SaveActions(table.finalizerActions[state], out);
+        out << "\n";
+    }
+
+    out << "stack " << table.stackSymbols.size();
+    for( char symbol : table.stackSymbols )
+    {
+        out << ' ' << static_cast<int>(static_cast<unsigned char>(symbol));
+    }
+    out << "\nclasses " << table.classCount << "\n";
+    for( size_t byte = 0; byte < ByteCount; ++byte )
+    {
+        out << static_cast<int>(table.byteClass[byte]) << (byte % 32 == 31 ? "\n" : " ");
+    }
+
+    // Только переходы, которые что-то делают
+    for( size_t state = 0; state < table.states.size(); ++state )
+    {
+        for( size_t top = 0; top < table.TopCount(); ++top )
+        {
+            for( size_t cls = 0; cls < table.classCount; ++cls )
+            {
+                auto const& entry = table.At(state, top, cls);
+                if( entry == TableEntry{} )
+                {
+                    continue;
+                }
+                out << "entry " << state << ' ' << top << ' ' << cls << ' ' << entry.next << ' ' << entry.pop
+                    << ' ' << entry.push.size();
+                for( char symbol : entry.push )
+                {
+                    out << ' ' << static_cast<int>(static_cast<unsigned char>(symbol));
+                }
+                out << ' ';
+                SaveActions(entry.actions, out);
+                out << "\n";
+            }
+        }
+    }
+    out << "end\n";
+}
+
+TransitionTable LoadTable(std::istream& in)
+{
+    std::string header;
+    std::getline(in, header);
+    if( header != TableFormat )
+    {
+        MalformedTable("unknown format");
+    }
+
+    TransitionTable table;
+    Expect(in, "states");
+    const auto stateCount = ReadCount(in, MaxListLength, "state count");
+    if( stateCount == 0 )
+    {
+        MalformedTable("no states");
+    }
+    Expect(in, "start");
+    table.start = static_cast<int>(ReadIndex(in, stateCount, "start state"));
+    for( size_t state = 0; state < stateCount; ++state )
+    {
+        table.isFinal.push_back(Read<bool>(in, "final flag"));
+        table.states.push_back(Read<std::string>(in, "state name"));
+        table.finalizerActions.push_back(LoadActions(in));
+    }
+
+    Expect(in, "stack");
+    table.stackSymbols.resize(ReadCount(in, ByteCount, "stack symbol count"));
+    for( auto& symbol : table.stackSymbols )
+    {
+        symbol = static_cast<char>(ReadIndex(in, ByteCount, "stack symbol"));
+    }
+
+    Expect(in, "classes");
+    table.classCount = Read<size_t>(in, "class count");
+    if( table.classCount == 0 || table.classCount > ByteCount )
+    {
+        MalformedTable("class count out of range");
+    }
+    for( auto& cls : table.byteClass )
+    {
+        cls = static_cast<std::uint8_t>(ReadIndex(in, table.classCount, "byte class"));
+    }
+
+    if( stateCount * table.TopCount() * table.classCount > MaxEntryCount )
+    {
+        MalformedTable("too many entries");
+    }
+    table.entries.resize(stateCount * table.TopCount() * table.classCount);
+    for( auto keyword = Read<std::string>(in, "entry"); keyword != "end"; keyword = Read<std::string>(in, "entry") )
+    {
+        if( keyword != "entry" )
+        {
+            MalformedTable("expected entry");
+        }
+        const auto state = ReadIndex(in, stateCount, "entry state");
+        const auto top = ReadIndex(in, table.TopCount(), "entry stack top");
+        const auto cls = ReadIndex(in, table.classCount, "entry class");
+        auto& entry = table.At(state, top, cls);
+        const auto next = Read<int>(in, "next state");
+        if( next < TableEntry::NoState || next >= static_cast<int>(stateCount) )
+        {
+            MalformedTable("next state out of range");
+        }
+        entry.next = next;
+        entry.pop = Read<bool>(in, "pop flag");
+        entry.push.resize(ReadCount(in, MaxListLength, "push count"));
+        for( auto& symbol : entry.push )
+        {
+            symbol = static_cast<char>(ReadIndex(in, ByteCount, "pushed stack symbol"));
+            if( table.stackSymbols.find(symbol) == std::string::npos )
+            {
+                MalformedTable("pushed symbol is not a stack symbol");
+            }
+        }
+        entry.actions = LoadActions(in);
+    }
+    return table;
+}
+
+} // namespace compilers
+} // namespace tusur
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stack>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <compilation.h>
+#include <errors.h>
+#include <pda.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+///@brief Действие перехода над контекстом автомата
+struct TransitionAction
+{
+    enum Kind : std::uint8_t
+    {
+        PushSymbol,     // PushToLexeme(считанный символ)
+        PushLiteral,    // PushToLexeme(symbol)
+        CompleteLexeme, // CompleteLexeme(lexeme)
+        AddError,       // AddError(error)
+    };
+
+    Kind kind;
+    char symbol = 0;
+    LexemeType lexeme = Identifier;
+    std::string error;
+
+    bool operator==(TransitionAction const&) const = default;
+};
+
+using ActionList = std::vector<TransitionAction>;
+
+///@brief Контекст, который вместо компиляции записывает действия, вызванные переходом
+class RecordingContext
+{
+public:
+    ///@param inputSymbol Символ, на котором проверяется переход
+    explicit RecordingContext(char inputSymbol = 0);
+
+    void PushToLexeme(char symbol);
+    void CompleteLexeme(LexemeType type);
+    void AddError(std::string&& error);
+
+    ActionList const& Actions() const;
+
+private:
+    char inputSymbol_;
+    ActionList actions_;
+};
+
+using ProbeAutomaton = PushdownAutomaton<RecordingContext, char>;
+
+///@brief Переход в таблице
+struct TableEntry
+{
+    static constexpr int NoState = -1;
+
+    int next = NoState; // NoState - перехода нет, автомат останавливается
+    bool pop = false;   // снять вершину стека
+    std::string push;   // положить на стек, снизу вверх
+    ActionList actions;
+
+    bool operator==(TableEntry const&) const = default;
+};
+
+///@brief Таблица переходов автомата со стеком символов
+///
+/// Переход зависит от состояния, вершины стека и класса считанного байта. Байты одного класса ведут себя
+/// одинаково во всех состояниях, поэтому в таблице столбец на класс, а не на каждый из 256 байт.
+struct TransitionTable
+{
+    std::vector<std::string> states;
+    std::vector<bool> isFinal;
+    std::vector<ActionList> finalizerActions;
+    int start = 0;
+    std::string stackSymbols; // вершина 0 - пустой стек, вершина i - stackSymbols[i - 1]
+    std::array<std::uint8_t, 256> byteClass{};
+    size_t classCount = 0;
+    std::vector<TableEntry> entries;
+
+    size_t TopCount() const;
+
+    ///@brief Номер вершины стека для At
+    size_t TopIndex(std::stack<char> const& stack) const;
+
+    TableEntry const& At(size_t state, size_t top, size_t byteClass) const;
+    TableEntry& At(size_t state, size_t top, size_t byteClass);
+
+    ///@returns Номер состояния либо TableEntry::NoState
+    int FindState(std::string const& name) const;
+};
+
+///@brief Снять таблицу переходов, перебрав в каждом состоянии все байты и вершины стека
+///
+/// Функции перехода должны зависеть только от считанного байта и вершины стека и менять только вершину.
+/// Вершины стека, которые кладут переходы, находятся по ходу перебора.
+TransitionTable ExtractTable(ProbeAutomaton& pda, std::string const& startState);
+
+///@brief Результат анализа графа состояний
+struct StateGraphReport
+{
+    std::vector<std::string> unreachable; // недостижимы из начального
+    std::vector<std::string> dead;        // из них недостижимо ни одно конечное
+    std::vector<std::vector<std::string>> equivalent; // группы неразличимых состояний
+};
+
+StateGraphReport AnalyzeStateGraph(TransitionTable const& table);
+
+///@brief Минимизировать автомат алгоритмом Хопкрофта
+///
+/// Состояния эквивалентны, если у них одинаковы конечность и действия финализатора, а для каждой вершины
+/// стека и класса байт - действия, операции со стеком и классы следующих состояний. Недостижимые состояния
+/// отбрасываются. Класс состояний называется по начальному состоянию, если оно в классе, иначе по первому.
+TransitionTable MinimizeTable(TransitionTable const& table);
+
+///@brief Сводка по таблице и её минимизации
+std::string FormatTableReport(TransitionTable const& table, StateGraphReport const& report, TransitionTable const& minimal);
+
+///@brief Граф состояний для Graphviz
+std::string TableToDot(TransitionTable const& table);
+
+void SaveTable(TransitionTable const& table, std::ostream& out);
+
+TransitionTable LoadTable(std::istream& in);
+
+///@brief Зарегистрировать состояния автомата, переходы которого берутся из таблицы
+template<typename C>
+void RegisterTableStates(PushdownAutomaton<C, char>& pda, TransitionTable const& table);
+
+
+// Имплементация
+
+template<typename C>
+void ApplyActions(ActionList const& actions, char symbol, C& context)
+{
+    for( auto const& action : actions )
+    {
+        switch( action.kind )
+        {
+            case TransitionAction::PushSymbol:
+                context.PushToLexeme(symbol);
+                break;
+            case TransitionAction::PushLiteral:
+                context.PushToLexeme(action.symbol);
+                break;
+            case TransitionAction::CompleteLexeme:
+                context.CompleteLexeme(action.lexeme);
+                break;
+            case TransitionAction::AddError:
+                context.AddError(std::string(action.error));
+                break;
+        }
+    }
+}
+
+template<typename C>
+void RegisterTableStates(PushdownAutomaton<C, char>& pda, TransitionTable const& table)
+{
+    auto shared = std::make_shared<TransitionTable const>(table);
+    for( size_t state = 0; state < shared->states.size(); ++state )
+    {
+        pda.RegisterTransition(shared->states[state], shared->isFinal[state],
+            [shared, state](char symbol, std::stack<char>& stack, C& context) -> TransitionResult
+            {
+                auto const& entry = shared->At(state, shared->TopIndex(stack),
+                                               shared->byteClass[static_cast<unsigned char>(symbol)]);
+                ApplyActions(entry.actions, symbol, context);
+                if( entry.next == TableEntry::NoState )
+                {
+                    return std::nullopt;
+                }
+                if( entry.pop )
+                {
+                    stack.pop();
+                }
+                for( char item : entry.push )
+                {
+                    stack.push(item);
+                }
+                return shared->states[entry.next];
+            });
+    }
+
+    // Финализатор получает имя состояния, по которому действия находятся без перебора всех имен
+    std::unordered_map<std::string, ActionList const*> finalizers;
+    for( size_t state = 0; state < shared->states.size(); ++state )
+    {
+        finalizers.emplace(shared->states[state], &shared->finalizerActions[state]);
+    }
+    pda.SetFinalizer([shared, finalizers = std::move(finalizers)](char symbol, std::string const& state,
+                                                                  std::stack<char>&, C& context)
+        {
+            auto actions = finalizers.find(state);
+            if( actions != finalizers.end() )
+            {
+                ApplyActions(*actions->second, symbol, context);
+            }
+        });
+}
+
+} // namespace compilers
+} // namespace tusur
@@ -0,0 +1,627 @@
+#include <batch_reader.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define LAB1C_HAS_IO_URING 1
+#endif
+
+namespace tusur
+{
+namespace compilers
+{
+
+namespace
+{
+
+// Файлы маленькие, так что обычно хватает одного чтения
+constexpr size_t InitialReadSize = 4096;
+
+// Чтение пулом потоков через pread
+class PreadLoader : public FileBatchLoader
+{
+public:
+    explicit PreadLoader(unsigned threadCount)
+    {
+        for( unsigned i = 0; i < threadCount; ++i )
+        {
+            threads_.emplace_back(&PreadLoader::Worker, this);
+        }
+    }
+
+    ~PreadLoader() override
+    {
+        {
+            std::lock_guard lock(mutex_);
+            stopped_ = true;
+        }
+        cv_.notify_all();
+        for( auto& thread : threads_ )
+        {
+            thread.join();
+        }
+    }
+
+    void Load(std::vector<SourceFile>& files) override
+    {
+        std::unique_lock lock(mutex_);
+        files_ = &files;
+        nextFile_ = 0;
+        remaining_ = files.size();
+        ++generation_;
+        cv_.notify_all();
+        done_.wait(lock, [this]{ return remaining_ == 0; });
+        files_ = nullptr;
+    }
+
+    char const* Name() const override
+    {
+        return "pread";
+    }
+
+private:
+    void Worker()
+    {
+        size_t seenGeneration = 0;
+        std::unique_lock lock(mutex_);
+        while( true )
+        {
+            cv_.wait(lock, [&]{ return stopped_ || generation_ != seenGeneration; });
+            if( stopped_ )
+            {
+                return;
+            }
+            seenGeneration = generation_;
+
+            while( files_ && nextFile_ < files_->size() )
+            {
+                auto& file = (*files_)[nextFile_++];
+                lock.unlock();
+                ReadFile(file);
+                lock.lock();
+                if( --remaining_ == 0 )
+                {
+                    done_.notify_one();
+                }
+            }
+        }
+    }
+
+    static void ReadFile(SourceFile& file)
+    {
+        const int fd = ::open(file.name.c_str(), O_RDONLY | O_CLOEXEC);
+        if( fd < 0 )
+        {
+            file.error = std::strerror(errno);
+            return;
+        }
+
+        struct stat info;
+        file.content.resize(::fstat(fd, &info) == 0 && info.st_size > 0 ? info.st_size : InitialReadSize);
+        size_t offset = 0;
+        while( true )
+        {
+            if( offset == file.content.size() )
+            {
+                file.content.resize(file.content.size() * 2);
+            }
+            const ssize_t size = ::pread(fd, file.content.data() + offset, file.content.size() - offset, offset);
+            if( size < 0 && errno == EINTR )
+            {
+                continue;
+            }
+            if( size < 0 )
+            {
+                file.error = std::strerror(errno);
+                break;
+            }
+            if( size == 0 )
+            {
+                break;
+            }
+            offset += size;
+        }
+        file.content.resize(offset);
+        ::close(fd);
+    }
+
+private:
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable done_;
+    std::vector<SourceFile>* files_ = nullptr;
+    size_t nextFile_ = 0;
+    size_t remaining_ = 0;
+    size_t generation_ = 0;
+    bool stopped_ = false;
+};
+
+#ifdef LAB1C_HAS_IO_URING
+
+struct IoUringError : public std::runtime_error
+{
+    IoUringError(std::string const& what, unsigned unsubmitted)
+        : std::runtime_error(what)
+        , unsubmitted(unsubmitted)
+    {}
+
+    unsigned unsubmitted; // сколько последних запросов ядро так и не забрало
+};
+
+// Чтение через io_uring без liburing: кольца отображаются и заполняются вручную.
+// Пачка читается в три захода: все открытия, все чтения (повторяются для файлов больше буфера), все закрытия.
+// Если io_uring_enter отказал, кольцо больше не используется, а остальные файлы читаются через pread
+class IoUringLoader : public FileBatchLoader
+{
+public:
+    ///@returns nullptr, если ядро не поддерживает io_uring или нужные операции
+    static std::unique_ptr<IoUringLoader> Create(unsigned entries)
+    {
+        io_uring_params params{};
+        const int fd = ::syscall(__NR_io_uring_setup, entries, &params);
+        if( fd < 0 )
+        {
+            return nullptr;
+        }
+
+        std::unique_ptr<IoUringLoader> loader(new IoUringLoader(fd, params));
+        if( !loader->Map() || !loader->SupportsOperations() )
+        {
+            return nullptr;
+        }
+        return loader;
+    }
+
+    ~IoUringLoader() override
+    {
+        Release();
+    }
+
+    void Load(std::vector<SourceFile>& files) override
+    {
+        size_t first = 0;
+        while( first < files.size() && !fallback_ )
+        {
+            const size_t last = std::min<size_t>(files.size(), first + params_.sq_entries);
+            try
+            {
+                LoadChunk(files, first, last);
+                first = last;
+            }
+            catch(std::runtime_error&)
+            {
+                // Кольцо в неизвестном состоянии: закрываем его, отменяя запросы в работе
+                Release();
+                const unsigned threadCount = std::clamp<unsigned>(std::thread::hardware_concurrency(), 1, params_.sq_entries);
+                fallback_ = std::make_unique<PreadLoader>(threadCount);
+            }
+        }
+
+        if( fallback_ && first < files.size() )
+        {
+            // Файлы недочитанной порции читаются заново целиком
+            std::vector<SourceFile> rest;
+            for( size_t i = first; i < files.size(); ++i )
+            {
+                rest.push_back({ std::move(files[i].name), {}, std::nullopt });
+            }
+            fallback_->Load(rest);
+            std::move(rest.begin(), rest.end(), files.begin() + first);
+        }
+    }
+
+    char const* Name() const override
+    {
+        return fallback_ ? fallback_->Name() : "io_uring";
+    }
+
+private:
+    IoUringLoader(int fd, io_uring_params const& params)
+        : fd_(fd)
+        , params_(params)
+    {}
+
+    void Release()
+    {
+        if( sqes_ != MAP_FAILED )
+        {
+            ::munmap(sqes_, params_.sq_entries * sizeof(io_uring_sqe));
+        }
+        if( cqRing_ != MAP_FAILED && cqRing_ != sqRing_ )
+        {
+            ::munmap(cqRing_, cqRingSize_);
+        }
+        if( sqRing_ != MAP_FAILED )
+        {
+            ::munmap(sqRing_, sqRingSize_);
+        }
+        sqes_ = cqRing_ = sqRing_ = MAP_FAILED;
+        if( fd_ >= 0 )
+        {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    bool Map()
+    {
+        sqRingSize_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+        cqRingSize_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMap = params_.features & IORING_FEAT_SINGLE_MMAP;
+        if( singleMap )
+        {
+            sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+        }
+
+        sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+        if( sqRing_ == MAP_FAILED )
+        {
+            return false;
+        }
+        cqRing_ = singleMap
+                  ? sqRing_
+                  : ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        sqes_ = ::mmap(nullptr, params_.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+        return cqRing_ != MAP_FAILED && sqes_ != MAP_FAILED;
+    }
+
+    bool SupportsOperations()
+    {
+        const size_t probeSize = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+        std::vector<char> buffer(probeSize, 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+        if( ::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, 256) < 0 )
+        {
+            return false;
+        }
+        for( int op : { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE } )
+        {
+            if( op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED) )
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    unsigned& SqField(unsigned offset) { return *reinterpret_cast<unsigned*>(static_cast<char*>(sqRing_) + offset); }
+    unsigned& CqField(unsigned offset) { return *reinterpret_cast<unsigned*>(static_cast<char*>(cqRing_) + offset); }
+
+    io_uring_sqe& NextSqe(size_t userData)
+    {
+        const unsigned tail = SqField(params_.sq_off.tail) + pendingSubmissions_;
+        const unsigned index = tail & SqField(params_.sq_off.ring_mask);
+        (&SqField(params_.sq_off.array))[index] = index;
+        ++pendingSubmissions_;
+
+        auto& sqe = static_cast<io_uring_sqe*>(sqes_)[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.user_data = userData;
+        return sqe;
+    }
+
+    // Разобрать готовые завершения. Возвращает их число
+    template<typename Handler>
+    unsigned ReapCompletions(Handler& handler)
+    {
+        auto& headRef = CqField(params_.cq_off.head);
+        unsigned head = headRef;
+        const unsigned tail = std::atomic_ref<unsigned>(CqField(params_.cq_off.tail)).load(std::memory_order_acquire);
+        const unsigned mask = CqField(params_.cq_off.ring_mask);
+        auto* cqes = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(cqRing_) + params_.cq_off.cqes);
+        unsigned reaped = 0;
+        for( ; head != tail; ++head, ++reaped )
+        {
+            handler(cqes[head & mask].user_data, cqes[head & mask].res);
+        }
+        std::atomic_ref<unsigned>(headRef).store(head, std::memory_order_release);
+        return reaped;
+    }
+
+    // Отправить накопленные запросы и дождаться их завершения. handler(userData, res) вызывается на каждый.
+    // При ошибке уже готовые завершения тоже передаются handler, чтобы открытые файлы можно было закрыть
+    template<typename Handler>
+    void SubmitAndWait(Handler&& handler)
+    {
+        const unsigned expected = pendingSubmissions_;
+        std::atomic_ref<unsigned>(SqField(params_.sq_off.tail)).store(SqField(params_.sq_off.tail) + expected,
+                                                                       std::memory_order_release);
+        pendingSubmissions_ = 0;
+
+        unsigned toSubmit = expected;
+        unsigned completed = 0;
+        while( completed < expected )
+        {
+            const int submitted = ::syscall(__NR_io_uring_enter, fd_, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if( submitted < 0 )
+            {
+                if( errno == EINTR || errno == EAGAIN )
+                {
+                    continue;
+                }
+                const int error = errno;
+                ReapCompletions(handler);
+                throw IoUringError(std::string("io_uring_enter: ") + std::strerror(error), toSubmit);
+            }
+            toSubmit -= std::min<unsigned>(toSubmit, submitted);
+            completed += ReapCompletions(handler);
+        }
+    }
+
+    void LoadChunk(std::vector<SourceFile>& files, size_t first, size_t last)
+    {
+        std::vector<int> fds(last - first, -1);
+        try
+        {
+            ReadChunk(files, first, last, fds);
+        }
+        catch(std::runtime_error&)
+        {
+            for( int fd : fds )
+            {
+                if( fd >= 0 )
+                {
+                    ::close(fd);
+                }
+            }
+            throw;
+        }
+
+        std::vector<int> closing;
+        for( size_t i = first; i < last; ++i )
+        {
+            if( fds[i - first] >= 0 )
+            {
+                auto& sqe = NextSqe(i);
+                sqe.opcode = IORING_OP_CLOSE;
+                sqe.fd = fds[i - first];
+                closing.push_back(fds[i - first]);
+            }
+        }
+        try
+        {
+            SubmitAndWait([](size_t, int){});
+        }
+        catch(IoUringError& e)
+        {
+            // Ядро забирает запросы по порядку, так что не отправлены последние
+            for( size_t i = closing.size() - std::min<size_t>(closing.size(), e.unsubmitted); i < closing.size(); ++i )
+            {
+                ::close(closing[i]);
+            }
+            throw;
+        }
+    }
+
+    // Открыть и прочитать файлы порции. Открытые дескрипторы записываются в fds
+    void ReadChunk(std::vector<SourceFile>& files, size_t first, size_t last, std::vector<int>& fds)
+    {
+        std::vector<size_t> offsets(last - first, 0);
+
+        for( size_t i = first; i < last; ++i )
+        {
+            auto& sqe = NextSqe(i);
+            sqe.opcode = IORING_OP_OPENAT;
+            sqe.fd = AT_FDCWD;
+            sqe.addr = reinterpret_cast<uintptr_t>(files[i].name.c_str());
+            sqe.open_flags = O_RDONLY | O_CLOEXEC;
+        }
+        SubmitAndWait([&](size_t i, int res)
+        {
+            if( res < 0 )
+            {
+                files[i].error = std::strerror(-res);
+                return;
+            }
+            fds[i - first] = res;
+            files[i].content.resize(InitialReadSize);
+        });
+
+        // Читаем, пока файл не кончится: короткое чтение обычного файла означает конец
+        std::vector<size_t> reading;
+        for( size_t i = first; i < last; ++i )
+        {
+            if( fds[i - first] >= 0 )
+            {
+                reading.push_back(i);
+            }
+        }
+        while( !reading.empty() )
+        {
+            for( size_t i : reading )
+            {
+                auto& content = files[i].content;
+                const size_t offset = offsets[i - first];
+                if( offset == content.size() )
+                {
+                    content.resize(content.size() * 2);
+                }
+                auto& sqe = NextSqe(i);
+                sqe.opcode = IORING_OP_READ;
+                sqe.fd = fds[i - first];
+                sqe.addr = reinterpret_cast<uintptr_t>(content.data() + offset);
+                sqe.len = content.size() - offset;
+                sqe.off = offset;
+            }
+
+            std::vector<size_t> unfinished;
+            SubmitAndWait([&](size_t i, int res)
+            {
+                auto& file = files[i];
+                if( res < 0 )
+                {
+                    file.error = std::strerror(-res);
+                    file.content.clear();
+                    return;
+                }
+                auto& offset = offsets[i - first];
+                const size_t requested = file.content.size() - offset;
+                offset += res;
+                if( res > 0 && static_cast<size_t>(res) == requested )
+                {
+                    unfinished.push_back(i);
+                    return;
+                }
+                file.content.resize(offset);
+            });
+            reading.swap(unfinished);
+        }
+    }
+
+private:
+    int fd_;
+    io_uring_params params_;
+    size_t sqRingSize_ = 0;
+    size_t cqRingSize_ = 0;
+    void* sqRing_ = MAP_FAILED;
+    void* cqRing_ = MAP_FAILED;
+    void* sqes_ = MAP_FAILED;
+    unsigned pendingSubmissions_ = 0;
+    std::unique_ptr<PreadLoader> fallback_;
+};
+
+#endif // LAB1C_HAS_IO_URING
+
+std::unique_ptr<FileBatchLoader> CreateLoader(size_t batchSize)
+{
+#ifdef LAB1C_HAS_IO_URING
+    if( auto loader = IoUringLoader::Create(std::clamp<size_t>(batchSize, 1, 4096)) )
+    {
+        return loader;
+    }
+#endif
+    const unsigned threadCount = std::clamp<unsigned>(std::thread::hardware_concurrency(), 1, batchSize);
+    return std::make_unique<PreadLoader>(threadCount);
+}
+
+} // namespace anonymous
+
+std::vector<std::string> ExpandPaths(std::vector<std::string> const& paths)
+{
+    namespace fs = std::filesystem;
+
+    std::vector<std::string> files;
+    for( auto const& path : paths )
+    {
+        if( !fs::is_directory(path) )
+        {
+            files.push_back(path);
+            continue;
+        }
+
+        std::vector<std::string> directoryFiles;
+        for( auto const& entry : fs::directory_iterator(path) )
+        {
+            if( entry.is_regular_file() )
+            {
+                directoryFiles.push_back(entry.path().string());
+            }
+        }
+        std::sort(directoryFiles.begin(), directoryFiles.end());
+        files.insert(files.end(), directoryFiles.begin(), directoryFiles.end());
+    }
+    return files;
+}
+
+BatchReader::BatchReader(std::vector<std::string> paths, size_t batchSize)
+    : paths_(std::move(paths))
+    , batchSize_(std::max<size_t>(batchSize, 1))
+    , loader_(CreateLoader(batchSize_))
+    , thread_(&BatchReader::ReadAll, this)
+{
+}
+
+BatchReader::~BatchReader()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+std::optional<SourceFile> BatchReader::Next()
+{
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this]{ return finished_ || !ready_.empty(); });
+    if( ready_.empty() )
+    {
+        return std::nullopt;
+    }
+    auto file = std::move(ready_.front());
+    ready_.pop_front();
+    cv_.notify_all();
+    return file;
+}
+
+char const* BatchReader::LoaderName() const
+{
+    return loader_->Name();
+}
+
+void BatchReader::ReadAll()
+{
+    for( size_t first = 0; first < paths_.size(); first += batchSize_ )
+    {
+        // Держим прочитанными не больше двух пачек, чтобы не съесть всю память на больших каталогах
+        {
+            std::unique_lock lock(mutex_);
+            cv_.wait(lock, [this]{ return stopped_ || ready_.size() < batchSize_; });
+            if( stopped_ )
+            {
+                break;
+            }
+        }
+
+        const size_t last = std::min(paths_.size(), first + batchSize_);
+        std::vector<SourceFile> batch(last - first);
+        for( size_t i = first; i < last; ++i )
+        {
+            batch[i - first].name = paths_[i];
+        }
+
+        try
+        {
+            loader_->Load(batch);
+        }
+        catch(std::runtime_error& e)
+        {
+            for( auto& file : batch )
+            {
+                if( !file.error )
+                {
+                    file.error = e.what();
+                }
+            }
+        }
+
+        {
+            std::lock_guard lock(mutex_);
+            std::move(batch.begin(), batch.end(), std::back_inserter(ready_));
+        }
+        cv_.notify_all();
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        finished_ = true;
+    }
+    cv_.notify_all();
+}
+
+} // namespace compilers
+} // namespace tusur
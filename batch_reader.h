@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tusur
+{
+namespace compilers
+{
+
+struct SourceFile
+{
+    std::string name;
+    std::string content;
+    std::optional<std::string> error; // если файл не удалось прочитать
+};
+
+///@brief Раскрыть каталоги в списке путей в отсортированные списки обычных файлов в них
+std::vector<std::string> ExpandPaths(std::vector<std::string> const& paths);
+
+///@brief Способ чтения пачки файлов
+class FileBatchLoader
+{
+public:
+    virtual ~FileBatchLoader() = default;
+
+    ///@brief Прочитать файлы целиком
+    virtual void Load(std::vector<SourceFile>& files) = 0;
+
+    virtual char const* Name() const = 0;
+};
+
+///@brief Фоновое чтение множества файлов пачками
+///
+/// Файлы читаются через io_uring, а если он недоступен - пулом потоков с pread.
+/// Чтение следующих пачек идет, пока вызывающий обрабатывает уже прочитанные файлы.
+class BatchReader
+{
+public:
+    ///@param paths Пути к файлам
+    ///@param batchSize Сколько файлов открывать и читать за раз
+    explicit BatchReader(std::vector<std::string> paths, size_t batchSize = 64);
+    ~BatchReader();
+
+    ///@brief Следующий файл в порядке paths
+    ///@returns std::nullopt, когда файлы кончились
+    std::optional<SourceFile> Next();
+
+    ///@brief Имя используемого способа чтения
+    char const* LoaderName() const;
+
+private:
+    void ReadAll();
+
+private:
+    std::vector<std::string> paths_;
+    size_t batchSize_;
+    std::unique_ptr<FileBatchLoader> loader_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<SourceFile> ready_;
+    bool finished_ = false;
+    bool stopped_ = false;
+
+    std::thread thread_;
+};
+
+} // namespace compilers
+} // namespace tusur
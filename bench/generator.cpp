@@ -0,0 +1,139 @@
+#include <bench/generator.h>
+
+namespace tusur
+{
+namespace compilers
+{
+namespace bench
+{
+
+WorkloadGenerator::WorkloadGenerator(std::uint64_t seed)
+    : state_(seed)
+{
+}
+
+std::uint64_t WorkloadGenerator::Next()
+{
+    std::uint64_t z = (state_ += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+size_t WorkloadGenerator::Below(size_t bound)
+{
+    return Next() % bound;
+}
+
+std::string WorkloadGenerator::RandomIdentifier(size_t length)
+{
+    static const std::string first = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
+    static const std::string rest = first + "0123456789";
+
+    std::string id(1, first[Below(first.size())]);
+    while( id.size() < length )
+    {
+        id.push_back(rest[Below(rest.size())]);
+    }
+    return id;
+}
+
+std::string WorkloadGenerator::RandomScientific()
+{
+    std::string number = std::to_string(1 + Below(9)) + "." + std::to_string(Below(1000000)) + "e";
+    switch( Below(3) )
+    {
+        case 0: number += "+"; break;
+        case 1: number += "-"; break;
+        default: break;
+    }
+    return number + std::to_string(Below(300));
+}
+
+Workload WorkloadGenerator::Begin(std::string name)
+{
+    Workload workload{ std::move(name), {}, {} };
+    Add(workload, Identifier, "x");
+    workload.text += " ";
+    Add(workload, Assign, "=");
+    workload.text += " ";
+    return workload;
+}
+
+void WorkloadGenerator::Add(Workload& workload, LexemeType type, std::string text)
+{
+    workload.text += text;
+    workload.lexemes.emplace_back(type, std::move(text));
+}
+
+Workload WorkloadGenerator::DeepParentheses(size_t depth)
+{
+    auto workload = Begin("deep_parentheses");
+    for( size_t i = 0; i < depth; ++i )
+    {
+        Add(workload, OpeningParentheses, "(");
+    }
+    Add(workload, Identifier, RandomIdentifier(3));
+    for( size_t i = 0; i < depth; ++i )
+    {
+        const bool plus = Below(2);
+        Add(workload, plus ? PlusSign : MultipliesSign, plus ? "+" : "*");
+        Add(workload, Identifier, RandomIdentifier(3));
+        Add(workload, ClosingParentheses, ")");
+    }
+    return workload;
+}
+
+Workload WorkloadGenerator::LongIdentifiers(size_t count, size_t length)
+{
+    auto workload = Begin("long_identifiers");
+    for( size_t i = 0; i < count; ++i )
+    {
+        if( i > 0 )
+        {
+            Add(workload, PlusSign, "+");
+        }
+        Add(workload, Identifier, RandomIdentifier(length));
+    }
+    return workload;
+}
+
+Workload WorkloadGenerator::WideChain(size_t count)
+{
+    auto workload = Begin("wide_chain");
+    for( size_t i = 0; i < count; ++i )
+    {
+        if( i > 0 )
+        {
+            const bool plus = Below(2);
+            Add(workload, plus ? PlusSign : MultipliesSign, plus ? "+" : "*");
+        }
+        if( Below(2) )
+        {
+            Add(workload, Identifier, RandomIdentifier(1 + Below(8)));
+        }
+        else
+        {
+            Add(workload, IntegerNumber, std::to_string(Below(100000)));
+        }
+    }
+    return workload;
+}
+
+Workload WorkloadGenerator::ScientificLiterals(size_t count)
+{
+    auto workload = Begin("scientific_literals");
+    for( size_t i = 0; i < count; ++i )
+    {
+        if( i > 0 )
+        {
+            Add(workload, PlusSign, "+");
+        }
+        Add(workload, FloatingPointNumber, RandomScientific());
+    }
+    return workload;
+}
+
+} // namespace bench
+} // namespace compilers
+} // namespace tusur
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <compilation.h>
+
+namespace tusur
+{
+namespace compilers
+{
+namespace bench
+{
+
+///@brief Сгенерированное выражение вместе с его лексемами
+struct Workload
+{
+    std::string name;
+    std::string text;
+    std::vector<std::pair<LexemeType, std::string>> lexemes; // в порядке появления в text
+};
+
+///@brief Детерминированный генератор выражений для бенчмарков
+///
+/// Использует собственный splitmix64, а не распределения из <random>, чтобы при одном и том же
+/// seed выражения совпадали на всех платформах и стандартных библиотеках.
+class WorkloadGenerator
+{
+public:
+    explicit WorkloadGenerator(std::uint64_t seed);
+
+    ///@brief x = ((((a + b) * c) + d) ...) с глубиной вложенности depth
+    Workload DeepParentheses(size_t depth);
+
+    ///@brief Сумма count идентификаторов длины length
+    Workload LongIdentifiers(size_t count, size_t length);
+
+    ///@brief Цепочка из count операндов через случайные + и *
+    Workload WideChain(size_t count);
+
+    ///@brief Сумма count чисел в научной записи
+    Workload ScientificLiterals(size_t count);
+
+private:
+    std::uint64_t Next();
+    size_t Below(size_t bound);
+
+    std::string RandomIdentifier(size_t length);
+    std::string RandomScientific();
+
+    // Начать выражение "x = "
+    Workload Begin(std::string name);
+    void Add(Workload& workload, LexemeType type, std::string text);
+
+private:
+    std::uint64_t state_;
+};
+
+} // namespace bench
+} // namespace compilers
+} // namespace tusur
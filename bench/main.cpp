@@ -0,0 +1,361 @@
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <bench/generator.h>
+#include <automaton_table.h>
+#include <codegen.h>
+#include <compilation.h>
+#include <expression.h>
+#include <lab_one.h>
+#include <output.h>
+#include <recognizer.h>
+#include <register_machine.h>
+
+using namespace tusur::compilers;
+using namespace tusur::compilers::bench;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions
+{
+    std::uint64_t seed = 42;
+    size_t scale = 1000;              // число операндов в генерируемых выражениях
+    std::chrono::milliseconds minTime{200};
+    std::string filter;
+    std::string jsonOutput;
+    std::string baseline;
+    double threshold = 10;            // допустимое замедление относительно baseline, %
+};
+
+struct BenchResult
+{
+    std::string name;
+    double mbPerSecond;
+    double nsPerToken;
+};
+
+BenchOptions ProcessArgs(int argc, char** argv)
+{
+    BenchOptions options;
+    for( int i = 1; i < argc; ++i )
+    {
+        std::string arg(argv[i]);
+        if( i + 1 >= argc )
+        {
+            throw std::runtime_error("Missing value for " + arg);
+        }
+        std::string value(argv[++i]);
+
+        if( arg == "--seed" )
+        {
+            options.seed = std::stoull(value);
+        }
+        else if( arg == "--scale" )
+        {
+            options.scale = std::stoul(value);
+        }
+        else if( arg == "--min-time-ms" )
+        {
+            options.minTime = std::chrono::milliseconds(std::stoul(value));
+        }
+        else if( arg == "--filter" )
+        {
+            options.filter = value;
+        }
+        else if( arg == "--json" )
+        {
+            options.jsonOutput = value;
+        }
+        else if( arg == "--baseline" )
+        {
+            options.baseline = value;
+        }
+        else if( arg == "--threshold" )
+        {
+            options.threshold = std::stod(value);
+        }
+        else
+        {
+            throw std::runtime_error("Unknown option " + arg);
+        }
+    }
+    return options;
+}
+
+// Повторять body, пока не пройдет minTime. Возвращает среднее время одной итерации в наносекундах
+double Measure(std::chrono::milliseconds minTime, std::function<void()> const& body)
+{
+    body(); // прогрев
+
+    size_t iterations = 0;
+    const auto start = Clock::now();
+    auto elapsed = Clock::duration::zero();
+    while( elapsed < minTime )
+    {
+        body();
+        ++iterations;
+        elapsed = Clock::now() - start;
+    }
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+void FeedLexemes(Compilation& compilation, Workload const& workload)
+{
+    for( auto const& [type, text] : workload.lexemes )
+    {
+        for( char c : text )
+        {
+            compilation.PushToLexeme(c);
+        }
+        compilation.CompleteLexeme(type);
+    }
+}
+
+// Инкрементальная проверка должна совпадать с полной после любой правки. Правки случайные: удаление,
+// вставка куска того же выражения или откат к исходному тексту, контрольные точки частые
+void VerifyIncrementalCheck(std::vector<Workload> const& workloads, std::uint64_t seed)
+{
+    std::mt19937_64 random(seed);
+    for( auto const& workload : workloads )
+    {
+        IncrementalRecognizer editor(16);
+        editor.Reset(workload.text);
+        for( int i = 0; i < 1000; ++i )
+        {
+            const auto& text = editor.Text();
+            const size_t offset = random() % (text.size() + 1);
+            const size_t removed = std::min<size_t>(random() % 8, text.size() - offset);
+            const size_t from = random() % (workload.text.size() + 1);
+            const auto inserted = std::string_view(workload.text).substr(from, random() % 8);
+            if( random() % 16 == 0 )
+            {
+                editor.Edit(0, text.size(), workload.text);
+            }
+            else
+            {
+                editor.Edit(offset, removed, inserted);
+            }
+
+            const auto expected = RecognizeLabOne(editor.Text());
+            if( editor.Result().flags != expected.flags || editor.Result().errorOffset != expected.errorOffset )
+            {
+                throw std::runtime_error("Incremental check differs from RecognizeLabOne on " + workload.name);
+            }
+        }
+    }
+}
+
+std::string ResultsToJson(std::vector<BenchResult> const& results)
+{
+    std::ostringstream json;
+    json << std::setprecision(6) << "{\n  \"results\": [\n";
+    for( size_t i = 0; i < results.size(); ++i )
+    {
+        json << "    {\"name\": \"" << results[i].name << "\", "
+             << "\"mb_per_s\": " << results[i].mbPerSecond << ", "
+             << "\"ns_per_token\": " << results[i].nsPerToken << "}"
+             << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+    return json.str();
+}
+
+// Разбор JSON, который пишет ResultsToJson: из него нужны только имя и ns_per_token
+std::map<std::string, double> ReadBaseline(std::string const& path)
+{
+    std::ifstream file(path);
+    if( !file.is_open() )
+    {
+        throw std::runtime_error("Couldn't open baseline " + path);
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    const std::string json = content.str();
+
+    std::map<std::string, double> baseline;
+    const std::string nameKey = "\"name\": \"";
+    const std::string timeKey = "\"ns_per_token\": ";
+    for( size_t pos = json.find(nameKey); pos != std::string::npos; pos = json.find(nameKey, pos) )
+    {
+        pos += nameKey.size();
+        const size_t nameEnd = json.find('"', pos);
+        const size_t time = json.find(timeKey, nameEnd);
+        if( nameEnd == std::string::npos || time == std::string::npos )
+        {
+            throw std::runtime_error("Malformed baseline " + path);
+        }
+        baseline[json.substr(pos, nameEnd - pos)] = std::stod(json.substr(time + timeKey.size()));
+    }
+    return baseline;
+}
+
+} // namespace anonymous
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        const auto options = ProcessArgs(argc, argv);
+#ifndef __OPTIMIZE__
+        std::cerr << "Warning: lab1c_bench is built without optimization, measurements are not representative" << std::endl;
+#endif
+
+        WorkloadGenerator generator(options.seed);
+        const std::vector<Workload> workloads = {
+            generator.DeepParentheses(options.scale),
+            generator.LongIdentifiers(options.scale, 64),
+            generator.WideChain(options.scale),
+            generator.ScientificLiterals(options.scale),
+        };
+
+        VerifyIncrementalCheck(workloads, options.seed);
+
+        LabOneAutomaton pda;
+        RegisterLabOneStates(pda);
+
+        // Тот же автомат, переходы которого берутся из минимизированной таблицы
+        ProbeAutomaton probe;
+        RegisterLabOneStates(probe);
+        LabOneAutomaton tablePda;
+        RegisterTableStates(tablePda, MinimizeTable(ExtractTable(probe, state_names::Begin)));
+
+        OutputWriter devNull("/dev/null"); // приемник кода для streaming_codegen
+        std::map<std::string, IncrementalRecognizer> editors; // уже проверенные выражения для incremental_check
+
+        // Что именно измеряется на каждом выражении
+        const std::vector<std::pair<std::string, std::function<void(Workload const&)>>> stages = {
+            { "automaton", [&pda](Workload const& workload)
+                {
+                    Compilation compilation;
+                    pda.ProcessText(workload.text.cbegin(), workload.text.cend(), state_names::Begin, compilation);
+                } },
+            { "table_automaton", [&tablePda](Workload const& workload)
+                {
+                    Compilation compilation;
+                    tablePda.ProcessText(workload.text.cbegin(), workload.text.cend(), state_names::Begin, compilation);
+                } },
+            { "recognizer", [](Workload const& workload)
+                {
+                    RecognizeLabOne(workload.text);
+                } },
+            { "incremental_check", [&editors](Workload const& workload)
+                {
+                    // Нажатие клавиши посреди выражения и его отмена
+                    auto [editor, isNew] = editors.try_emplace(workload.name);
+                    if( isNew )
+                    {
+                        editor->second.Reset(workload.text);
+                    }
+                    const size_t middle = workload.text.size() / 2;
+                    editor->second.Edit(middle, 0, std::string_view(workload.text).substr(middle, 1));
+                    editor->second.Edit(middle, 1, {});
+                } },
+            { "codegen", [](Workload const& workload)
+                {
+                    Compilation compilation;
+                    FeedLexemes(compilation, workload);
+                    compilation.GenerateRemainingCode();
+                } },
+            { "streaming_codegen", [&devNull](Workload const& workload)
+                {
+                    Compilation compilation;
+                    compilation.SetCodeSink(&devNull);
+                    FeedLexemes(compilation, workload);
+                    compilation.GenerateRemainingCode();
+                } },
+            { "parallel_codegen", [](Workload const& workload)
+                {
+                    std::vector<Lexeme> lexemes;
+                    for( auto const& [type, text] : workload.lexemes )
+                    {
+                        lexemes.push_back({ type, text });
+                    }
+                    GenerateCodeParallel(lexemes, 0);
+                } },
+            { "register_codegen", [](Workload const& workload)
+                {
+                    std::vector<Lexeme> lexemes;
+                    for( auto const& [type, text] : workload.lexemes )
+                    {
+                        lexemes.push_back({ type, text });
+                    }
+                    ExpressionTree tree(lexemes.begin() + 2, lexemes.end());
+                    AllocateRegisters(LowerToRegisterCode(tree, lexemes[0].text));
+                } },
+            { "end_to_end", [&pda](Workload const& workload)
+                {
+                    std::string report;
+                    StringOutput out(report);
+                    CompileStatement(pda, workload.text, false, out);
+                } },
+        };
+
+        std::vector<BenchResult> results;
+        for( auto const& workload : workloads )
+        {
+            for( auto const& [stage, body] : stages )
+            {
+                const std::string name = stage + "/" + workload.name;
+                if( name.find(options.filter) == std::string::npos )
+                {
+                    continue;
+                }
+
+                const double ns = Measure(options.minTime, [&body, &workload]{ body(workload); });
+                results.push_back({ name, workload.text.size() * 1e3 / ns, ns / workload.lexemes.size() });
+                std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(2)
+                          << std::setw(10) << results.back().mbPerSecond << " MB/s"
+                          << std::setw(10) << results.back().nsPerToken << " ns/token" << std::endl;
+            }
+        }
+
+        if( !options.jsonOutput.empty() )
+        {
+            std::ofstream file(options.jsonOutput);
+            if( !(file << ResultsToJson(results)) )
+            {
+                throw std::runtime_error("Couldn't write results to " + options.jsonOutput);
+            }
+        }
+
+        if( !options.baseline.empty() )
+        {
+            const auto baseline = ReadBaseline(options.baseline);
+            bool regressed = false;
+            for( auto const& result : results )
+            {
+                auto found = baseline.find(result.name);
+                if( found == baseline.end() )
+                {
+                    continue;
+                }
+                const double change = (result.nsPerToken / found->second - 1) * 100;
+                if( change > options.threshold )
+                {
+                    std::cout << "REGRESSION " << result.name << ": " << std::setprecision(1) << change
+                              << "% slower than baseline (threshold " << options.threshold << "%)" << std::endl;
+                    regressed = true;
+                }
+            }
+            return regressed ? 1 : 0;
+        }
+
+        return 0;
+    }
+    catch(std::runtime_error& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+}
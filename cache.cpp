@@ -0,0 +1,250 @@
+#include <cache.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include <unistd.h>
+
+#include <helpers.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+// Меняется при изменении формата записи или генерируемого кода, чтобы не читать старые записи
+const std::string CacheFormat = "lab1c-cache 2";
+
+// После вытеснения кэш занимает не больше этой доли лимита, чтобы каталог не сканировался при каждой записи
+constexpr std::uintmax_t EvictionTargetPercent = 90;
+
+// Записи кэша - файлы из 16 шестнадцатеричных цифр. Временные и посторонние файлы не трогаем
+bool IsEntryName(std::string const& name)
+{
+    return name.size() == 16 && std::all_of(name.begin(), name.end(), [](char c){ return std::isxdigit(c); });
+}
+
+bool ReadSized(std::istream& in, std::string& out)
+{
+    size_t size = 0;
+    if( !(in >> size) || in.get() != '\n' )
+    {
+        return false;
+    }
+    out.resize(size);
+    return in.read(out.data(), size) && in.get() == '\n';
+}
+
+void WriteSized(std::ostream& out, std::string const& data)
+{
+    out << data.size() << '\n' << data << '\n';
+}
+
+} // namespace anonymous
+
+CompileCache::CompileCache(std::filesystem::path directory, std::uintmax_t sizeLimit, std::string options)
+    : directory_(std::move(directory))
+    , sizeLimit_(sizeLimit)
+    , options_(std::move(options))
+{
+    std::error_code ec;
+    fs::create_directories(directory_, ec);
+    if( ec )
+    {
+        throw std::runtime_error("Couldn't create cache directory " + directory_.string() + ": " + ec.message());
+    }
+}
+
+std::string CompileCache::MakeKey(std::string const& statement) const
+{
+    // Пробельные символы все состояния автомата обрабатывают одинаково, поэтому
+    // серии пробелов схлопываются в один, а по краям отбрасываются
+    std::string key;
+    key.reserve(statement.size() + options_.size() + 1);
+    bool pendingSpace = false;
+    for( char c : statement )
+    {
+        if( std::isspace(c) )
+        {
+            pendingSpace = !key.empty();
+            continue;
+        }
+        if( pendingSpace )
+        {
+            key.push_back(' ');
+            pendingSpace = false;
+        }
+        key.push_back(c);
+    }
+    key.push_back('\0');
+    key += options_;
+    return key;
+}
+
+std::filesystem::path CompileCache::EntryPath(std::string const& key) const
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(helpers::hash64(key)));
+    return directory_ / name;
+}
+
+std::optional<CachedCompilation> CompileCache::Find(std::string const& statement)
+{
+    const auto key = MakeKey(statement);
+    const auto path = EntryPath(key);
+
+    std::ifstream in(path, std::ios::binary);
+    std::string header, storedKey;
+    CachedCompilation result;
+    size_t symbolCount = 0;
+    bool valid = in.is_open()
+              && std::getline(in, header) && header == CacheFormat
+              && ReadSized(in, storedKey) && storedKey == key
+              && ReadSized(in, result.code)
+              && ReadSized(in, result.notes)
+              && (in >> symbolCount);
+    for( size_t i = 0; valid && i < symbolCount; ++i )
+    {
+        int type = 0;
+        std::string name;
+        valid = static_cast<bool>(in >> type >> name);
+        result.symbolTable.emplace(std::move(name), static_cast<LexemeType>(type));
+    }
+
+    if( !valid )
+    {
+        ++misses_;
+        return std::nullopt;
+    }
+
+    // Отметка для LRU. Ошибка не важна: запись могли вытеснить параллельно
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+
+    ++hits_;
+    return result;
+}
+
+void CompileCache::Store(std::string const& statement, CachedCompilation const& result)
+{
+    static std::atomic<unsigned> tempCounter = 0;
+
+    const auto key = MakeKey(statement);
+    const auto path = EntryPath(key);
+    auto tempPath = path;
+    tempPath += ".tmp." + std::to_string(::getpid()) + "." + std::to_string(tempCounter++);
+
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out << CacheFormat << '\n';
+        WriteSized(out, key);
+        WriteSized(out, result.code);
+        WriteSized(out, result.notes);
+        out << result.symbolTable.size() << '\n';
+        for( auto const& [name, type] : result.symbolTable )
+        {
+            out << static_cast<int>(type) << ' ' << name << '\n';
+        }
+        if( !out.good() )
+        {
+            std::error_code ec;
+            fs::remove(tempPath, ec);
+            return; // кэш - не повод ронять компиляцию
+        }
+    }
+
+    if( !usedSize_ )
+    {
+        usedSize_ = Evict();
+    }
+
+    // Заменяемая запись (коллизия хэша или запись другого процесса) освобождает свое место
+    std::error_code writtenEc, replacedEc;
+    const auto written = fs::file_size(tempPath, writtenEc);
+    const auto replaced = fs::file_size(path, replacedEc);
+
+    // rename атомарен, так что читатели видят либо старую запись, либо новую целиком
+    std::error_code ec;
+    fs::rename(tempPath, path, ec);
+    if( ec )
+    {
+        fs::remove(tempPath, ec);
+        return;
+    }
+
+    *usedSize_ += writtenEc ? 0 : written;
+    *usedSize_ -= replacedEc ? 0 : std::min(*usedSize_, replaced);
+    if( *usedSize_ > sizeLimit_ )
+    {
+        usedSize_ = Evict();
+    }
+}
+
+std::uintmax_t CompileCache::Evict()
+{
+    struct Entry
+    {
+        fs::path path;
+        std::uintmax_t size;
+        fs::file_time_type lastUse;
+    };
+
+    std::vector<Entry> entries;
+    std::uintmax_t totalSize = 0;
+    std::error_code ec;
+    for( auto const& file : fs::directory_iterator(directory_, ec) )
+    {
+        if( !IsEntryName(file.path().filename().string()) )
+        {
+            continue;
+        }
+        std::error_code sizeEc, timeEc;
+        Entry entry{ file.path(), file.file_size(sizeEc), file.last_write_time(timeEc) };
+        if( !sizeEc && !timeEc )
+        {
+            totalSize += entry.size;
+            entries.push_back(std::move(entry));
+        }
+    }
+
+    if( totalSize <= sizeLimit_ )
+    {
+        return totalSize;
+    }
+
+    const std::uintmax_t target = sizeLimit_ / 100 * EvictionTargetPercent;
+    std::sort(entries.begin(), entries.end(), [](auto const& lhs, auto const& rhs){ return lhs.lastUse < rhs.lastUse; });
+    for( auto const& entry : entries )
+    {
+        if( totalSize <= target )
+        {
+            break;
+        }
+        // Запись мог удалить другой процесс, тогда её размер уже не в кэше
+        fs::remove(entry.path, ec);
+        totalSize -= entry.size;
+    }
+    return totalSize;
+}
+
+size_t CompileCache::Hits() const
+{
+    return hits_;
+}
+
+size_t CompileCache::Misses() const
+{
+    return misses_;
+}
+
+} // namespace compilers
+} // namespace tusur
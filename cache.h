@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include <compilation.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+///@brief Результат компиляции, который можно сохранить в кэш
+struct CachedCompilation
+{
+    std::string code;
+    std::unordered_map<std::string, LexemeType> symbolTable;
+    std::string notes; // дополнительные сведения о генерации кода, выводятся после таблицы символов
+};
+
+///@brief Кэш результатов компиляции на диске
+///
+/// Каждая запись лежит в отдельном файле, имя которого - хэш нормализованного выражения и опций компилятора.
+/// Запись пишется во временный файл и переименовывается, так что несколько процессов могут работать
+/// с одним каталогом одновременно без блокировок. Время модификации файла служит отметкой для LRU.
+class CompileCache
+{
+public:
+    ///@param directory Каталог кэша, создается при необходимости
+    ///@param sizeLimit Максимальный суммарный размер записей в байтах
+    ///@param options Строка опций компилятора, влияющих на результат
+    CompileCache(std::filesystem::path directory, std::uintmax_t sizeLimit, std::string options);
+
+    ///@brief Найти результат компиляции выражения
+    ///@returns std::nullopt если записи нет или она повреждена
+    std::optional<CachedCompilation> Find(std::string const& statement);
+
+    ///@brief Сохранить результат компиляции выражения и вытеснить старые записи при переполнении
+    void Store(std::string const& statement, CachedCompilation const& result);
+
+    size_t Hits() const;
+    size_t Misses() const;
+
+private:
+    // Нормализованное выражение вместе с опциями. Хранится в записи для проверки коллизий хэша
+    std::string MakeKey(std::string const& statement) const;
+
+    std::filesystem::path EntryPath(std::string const& key) const;
+
+    // Просканировать каталог и удалить самые давно использованные записи, пока размер кэша больше
+    // нижней отметки. Возвращает размер оставшихся записей
+    std::uintmax_t Evict();
+
+private:
+    std::filesystem::path directory_;
+    std::uintmax_t sizeLimit_;
+    std::string options_;
+    // Размер кэша по последнему сканированию плюс записанное с тех пор этим процессом.
+    // Записи других процессов учитываются при следующем сканировании
+    std::optional<std::uintmax_t> usedSize_;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+};
+
+} // namespace compilers
+} // namespace tusur
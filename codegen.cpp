@@ -0,0 +1,172 @@
+#include <codegen.h>
+
+#include <algorithm>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <errors.h>
+#include <stats.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+namespace
+{
+
+using LexemeRange = std::pair<LexemeIterator, LexemeIterator>;
+
+// Итератор на скобку, закрывающую открытую в first
+LexemeIterator MatchingParenthesis(LexemeIterator first, LexemeIterator last)
+{
+    int depth = 0;
+    for( auto it = first; it != last; ++it )
+    {
+        if( it->type == OpeningParentheses )
+        {
+            ++depth;
+        }
+        else if( it->type == ClosingParentheses && --depth == 0 )
+        {
+            return it;
+        }
+    }
+    throw CompilationError("Unbalanced parentheses");
+}
+
+// Снять скобки, охватывающие весь диапазон: ((a + b)) -> a + b
+LexemeRange StripParentheses(LexemeIterator first, LexemeIterator last)
+{
+    while( first != last && first->type == OpeningParentheses && MatchingParenthesis(first, last) == last - 1 )
+    {
+        ++first;
+        --last;
+    }
+    return { first, last };
+}
+
+// Разбить диапазон по операциям op вне скобок
+std::vector<LexemeRange> SplitTopLevel(LexemeIterator first, LexemeIterator last, LexemeType op)
+{
+    std::vector<LexemeRange> parts;
+    int depth = 0;
+    auto partBegin = first;
+    for( auto it = first; it != last; ++it )
+    {
+        if( it->type == OpeningParentheses )
+        {
+            ++depth;
+        }
+        else if( it->type == ClosingParentheses )
+        {
+            --depth;
+        }
+        else if( depth == 0 && it->type == op )
+        {
+            parts.emplace_back(partBegin, it);
+            partBegin = it + 1;
+        }
+    }
+    parts.emplace_back(partBegin, last);
+    return parts;
+}
+
+} // namespace anonymous
+
+Operation GenerateCode(LexemeIterator first, LexemeIterator last)
+{
+    Compilation compilation;
+    compilation.SetReplay(true);
+    for( auto it = first; it != last; ++it )
+    {
+        for( char c : it->text )
+        {
+            compilation.PushToLexeme(c);
+        }
+        compilation.CompleteLexeme(it->type);
+    }
+    compilation.GenerateRemainingCode();
+    return compilation.GetResult();
+}
+
+Operation GenerateCodeParallel(std::vector<Lexeme> const& lexemes, unsigned threadCount)
+{
+    if( lexemes.size() < 3 || lexemes[0].type != Identifier || lexemes[1].type != Assign )
+    {
+        throw CompilationError("Assignment expected");
+    }
+
+    auto [first, last] = StripParentheses(lexemes.begin() + 2, lexemes.end());
+    auto op = PlusSign;
+    auto parts = SplitTopLevel(first, last, op);
+    if( parts.size() == 1 )
+    {
+        op = MultipliesSign;
+        parts = SplitTopLevel(first, last, op);
+    }
+
+    if( threadCount == 0 )
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = std::min<size_t>(threadCount, parts.size());
+
+#ifdef LAB1C_STATS
+    // Статистика потоков-генераторов после их завершения сливается в статистику вызывающего
+    std::mutex statsMutex;
+    Stats& callerStats = CurrentStats();
+#endif
+
+    // Операнды раздаются потокам подряд идущими кусками примерно равной длины в лексемах
+    std::vector<Operation> operands(parts.size());
+    std::vector<std::future<void>> tasks;
+    const size_t chunkSize = (last - first + threadCount - 1) / threadCount;
+    for( size_t begin = 0; begin < parts.size(); )
+    {
+        size_t end = begin;
+        size_t size = 0;
+        while( end < parts.size() && (end == begin || size < chunkSize) )
+        {
+            size += parts[end].second - parts[end].first;
+            ++end;
+        }
+
+        auto generate = [&operands, &parts, begin, end]
+        {
+            for( size_t i = begin; i < end; ++i )
+            {
+                operands[i] = GenerateCode(parts[i].first, parts[i].second);
+            }
+        };
+        if( end == parts.size() )
+        {
+            generate(); // последний кусок - в текущем потоке
+        }
+        else
+        {
+            tasks.push_back(std::async(std::launch::async, [&, generate]
+                {
+                    generate();
+                    LAB1C_STATS_DO( std::lock_guard lock(statsMutex); MergeStats(callerStats, CurrentStats()); CurrentStats() = {} );
+                }));
+        }
+        begin = end;
+    }
+    for( auto& task : tasks )
+    {
+        task.get();
+    }
+
+    // Свертки цепочки и присваивания идут мимо GenerateCodeOnce, но считаются так же, как при
+    // последовательной генерации
+    LAB1C_STATS_DO( CurrentStats().generateCodeOnceCalls += operands.size() );
+
+    // Операции с равным приоритетом выполняются слева направо
+    return Compilation::Combine(Assign, { lexemes[0].text, {} }, Compilation::CombineChain(op, operands));
+}
+
+} // namespace compilers
+} // namespace tusur
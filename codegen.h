@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include <compilation.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+using LexemeIterator = std::vector<Lexeme>::const_iterator;
+
+///@brief Последовательно сгенерировать код для выражения из лексем [first, last)
+Operation GenerateCode(LexemeIterator first, LexemeIterator last);
+
+///@brief Сгенерировать код присваивания, распараллелив правую часть по операндам верхнего уровня
+///
+/// Правая часть делится по + вне скобок, а если их нет - по *. Код операндов генерируется в отдельных потоках
+/// и собирается слева направо, как это делает Compilation::CompleteLexeme. Регистры выбираются только по
+/// регистрам операндов, поэтому код совпадает с последовательной генерацией.
+///@param lexemes Лексемы корректного выражения, см. Compilation::SetDeferredCodeGeneration
+///@param threadCount Число потоков, 0 - по числу ядер
+Operation GenerateCodeParallel(std::vector<Lexeme> const& lexemes, unsigned threadCount);
+
+} // namespace compilers
+} // namespace tusur
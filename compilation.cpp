@@ -1,6 +1,11 @@
 #include <compilation.h>
 
+#include <charconv>
+#include <string_view>
+#include <utility>
+
 #include <errors.h>
+#include <stats.h>
 
 namespace tusur
 {
@@ -14,24 +19,23 @@ std::string OperatoinCode(LexemeType operation, std::string const& lhs, std::str
 {
     // TODO: код формируется прямо как в презентации, не очень интуитивно. Подумать над способами лучше
     std::string code;
-    const auto RegisterName = std::to_string(Register);
+    char registerDigits[8];
+    const auto registerEnd = std::to_chars(registerDigits, registerDigits + sizeof(registerDigits), Register).ptr;
+    const std::string_view RegisterName(registerDigits, registerEnd - registerDigits);
     switch( operation )
     {
         case Assign:
-            code += "LOAD " + rhs
-                 + "\nSTORE " + lhs;
+            code.reserve(rhs.size() + lhs.size() + 12);
+            code.append("LOAD ").append(rhs)
+                .append("\nSTORE ").append(lhs);
             break;
         case PlusSign:
-            code += rhs
-                 + "\nSTORE $" + RegisterName
-                 + "\nLOAD " + lhs
-                 + "\nADD $" + RegisterName;
-            break;
         case MultipliesSign:
-            code += rhs
-                 + "\nSTORE $" + RegisterName
-                 + "\nLOAD " + lhs
-                 + "\nMPY $" + RegisterName;
+            code.reserve(rhs.size() + lhs.size() + 32);
+            code.append(rhs)
+                .append("\nSTORE $").append(RegisterName)
+                .append("\nLOAD ").append(lhs)
+                .append(operation == PlusSign ? "\nADD $" : "\nMPY $").append(RegisterName);
             break;
         default:
             throw CompilationError("Unknown operation: " + LexemeTypeToString(operation));
@@ -77,6 +81,13 @@ void Compilation::CompleteLexeme(LexemeType type)
 {
     auto [lexeme, isInserted] = symbolTable_.emplace( std::move(currentLexeme_), type );
     currentLexeme_.clear(); // надо ли?
+    LAB1C_STATS_DO( if( !replay_ ) ++CurrentStats().lexemes[type] );
+
+    if( deferred_ )
+    {
+        lexemeStream_.push_back({ type, lexeme->first });
+        return;
+    }
 
     switch (type)
     {
@@ -84,7 +95,15 @@ void Compilation::CompleteLexeme(LexemeType type)
         case IntegerNumber:
         case FloatingPointNumber:
         {
-            codeStack_.push({ lexeme->first, std::bitset<MAX_REGISTER_COUNT>() });
+            if( sink_ )
+            {
+                operandStack_.push_back({ lexeme->first });
+            }
+            else
+            {
+                codeStack_.push({ lexeme->first, std::bitset<MAX_REGISTER_COUNT>() });
+            }
+            LAB1C_STATS_MAX( peakCodeStack, OperandCount() );
             break;
         }
 
@@ -95,13 +114,14 @@ void Compilation::CompleteLexeme(LexemeType type)
             if( opStack_.empty() )
             {
                 opStack_.push(type);
+                LAB1C_STATS_MAX( peakOpStack, opStack_.size() );
                 break;
             }
 
             // TODO: можно ли засунуть сюда скобки?
-            while( type <= opStack_.top() ) // нестрогий знак т.к. операции с равным приоритетом выполняются слева направо
+            while( !opStack_.empty() && type <= opStack_.top() ) // нестрогий знак т.к. операции с равным приоритетом выполняются слева направо
             {
-                if( codeStack_.size() < 2 )
+                if( OperandCount() < 2 )
                 {
                     throw CompilationError("Not enough operands on stack!");
                 }
@@ -109,11 +129,13 @@ void Compilation::CompleteLexeme(LexemeType type)
             }
 
             opStack_.push(type);
+            LAB1C_STATS_MAX( peakOpStack, opStack_.size() );
             break;
         }
         case OpeningParentheses:
         {
             opStack_.push(type);
+            LAB1C_STATS_MAX( peakOpStack, opStack_.size() );
             break;
         }
         case ClosingParentheses:
@@ -134,20 +156,165 @@ void Compilation::CompleteLexeme(LexemeType type)
 
 void Compilation::GenerateCodeOnce()
 {
+    if( sink_ )
+    {
+        EmitCodeOnce();
+        return;
+    }
+
     auto opType = opStack_.top();
     opStack_.pop();
-    auto [rhs, rhsRegisters] = codeStack_.top();
+    auto rhs = std::move(codeStack_.top());
     codeStack_.pop();
-    auto [lhs, lhsRegisters] = codeStack_.top();
+    auto lhs = std::move(codeStack_.top());
     codeStack_.pop();
 
+    codeStack_.push(Combine(opType, lhs, rhs));
+    LAB1C_STATS_DO( ++CurrentStats().generateCodeOnceCalls );
+    LAB1C_STATS_MAX( registersUsed, codeStack_.top().registersUsed.count() );
+}
+
+void Compilation::EmitCodeOnce()
+{
+    auto opType = opStack_.top();
+    opStack_.pop();
+    auto rhs = operandStack_.back();
+    operandStack_.pop_back();
+    auto lhs = operandStack_.back();
+    operandStack_.pop_back();
+    LAB1C_STATS_DO( ++CurrentStats().generateCodeOnceCalls );
+
+    // Ячейки операндов освобождаются сразу: они прочитаны раньше, чем будет записан результат
+    for( auto const& operand : { lhs, rhs } )
+    {
+        if( operand.temp >= 0 )
+        {
+            freeTemps_.insert(operand.temp);
+        }
+    }
+
+    auto& out = *sink_;
+    auto load = [this, &out](StreamOperand const& operand)
+    {
+        if( operand.temp < 0 || operand.temp != accumulatorTemp_ )
+        {
+            out << "LOAD ";
+            WriteOperand(operand);
+            out << '\n';
+        }
+    };
+
+    if( opType == Assign )
+    {
+        load(rhs);
+        out << "STORE ";
+        WriteOperand(lhs);
+        out << '\n';
+        accumulatorTemp_ = -1;
+        return;
+    }
+    if( opType != PlusSign && opType != MultipliesSign )
+    {
+        throw CompilationError("Unknown operation: " + LexemeTypeToString(opType));
+    }
+
+    // + и * коммутативны, так что значение из аккумулятора можно взять левым операндом
+    if( rhs.temp >= 0 && rhs.temp == accumulatorTemp_ )
+    {
+        std::swap(lhs, rhs);
+    }
+
+    int temp = nextTemp_;
+    if( freeTemps_.empty() )
+    {
+        ++nextTemp_;
+    }
+    else
+    {
+        temp = *freeTemps_.begin();
+        freeTemps_.erase(freeTemps_.begin());
+    }
+    LAB1C_STATS_MAX( registersUsed, nextTemp_ );
+
+    load(lhs);
+    out << (opType == PlusSign ? "ADD " : "MPY ");
+    WriteOperand(rhs);
+    out << "\nSTORE $" << temp << '\n';
+    accumulatorTemp_ = temp;
+    operandStack_.push_back({ {}, temp });
+}
+
+void Compilation::WriteOperand(StreamOperand const& operand)
+{
+    if( operand.temp >= 0 )
+    {
+        *sink_ << '$' << operand.temp;
+    }
+    else
+    {
+        *sink_ << operand.name;
+    }
+}
+
+size_t Compilation::OperandCount() const
+{
+    return sink_ ? operandStack_.size() : codeStack_.size();
+}
+
+Operation Compilation::Combine(LexemeType operation, Operation const& lhs, Operation const& rhs)
+{
     // TODO: выбор регистра можно оптимизировать, если увидеть, что те регистры, что были использованы в
     // rhs, всегда можно переиспользовать
 
-    auto usedRegisters = lhsRegisters | rhsRegisters;
+    auto usedRegisters = lhs.registersUsed | rhs.registersUsed;
     int availableRegister = usedRegisters.count();
     usedRegisters |= 1 << availableRegister;
-    codeStack_.push({ OperatoinCode(opType, lhs, rhs, availableRegister), usedRegisters });
+    return { OperatoinCode(operation, lhs.code, rhs.code, availableRegister), usedRegisters };
+}
+
+Operation Compilation::CombineChain(LexemeType operation, std::vector<Operation> const& operands)
+{
+    if( operation != PlusSign && operation != MultipliesSign )
+    {
+        throw CompilationError("Unknown operation: " + LexemeTypeToString(operation));
+    }
+    if( operands.empty() )
+    {
+        throw CompilationError("Empty operand chain");
+    }
+
+    // Регистры выбираются так же, как в Combine
+    std::vector<int> registers(operands.size());
+    auto usedRegisters = operands.front().registersUsed;
+    size_t size = operands.front().code.size();
+    for( size_t i = 1; i < operands.size(); ++i )
+    {
+        usedRegisters |= operands[i].registersUsed;
+        registers[i] = usedRegisters.count();
+        usedRegisters |= 1 << registers[i];
+        size += operands[i].code.size() + 32;
+    }
+
+    // c(k) = operands[k] \nSTORE $r \nLOAD c(k - 1) \nADD $r, поэтому сначала идут операнды от последнего,
+    // затем первый операнд и операции от первой
+    std::string code;
+    code.reserve(size);
+    char registerDigits[8];
+    auto registerName = [&registerDigits](int reg)
+    {
+        const auto end = std::to_chars(registerDigits, registerDigits + sizeof(registerDigits), reg).ptr;
+        return std::string_view(registerDigits, end - registerDigits);
+    };
+    for( size_t i = operands.size() - 1; i > 0; --i )
+    {
+        code.append(operands[i].code).append("\nSTORE $").append(registerName(registers[i])).append("\nLOAD ");
+    }
+    code.append(operands.front().code);
+    for( size_t i = 1; i < operands.size(); ++i )
+    {
+        code.append(operation == PlusSign ? "\nADD $" : "\nMPY $").append(registerName(registers[i]));
+    }
+    return { std::move(code), usedRegisters };
 }
 
 void Compilation::GenerateRemainingCode()
@@ -163,6 +330,31 @@ std::string Compilation::GetCode() const
     return codeStack_.top().code;
 }
 
+Operation Compilation::GetResult() const
+{
+    return codeStack_.top();
+}
+
+void Compilation::SetCodeSink(OutputWriter* sink)
+{
+    sink_ = sink;
+}
+
+void Compilation::SetDeferredCodeGeneration(bool deferred)
+{
+    deferred_ = deferred;
+}
+
+void Compilation::SetReplay(bool replay)
+{
+    replay_ = replay;
+}
+
+std::vector<Lexeme> const& Compilation::GetLexemes() const
+{
+    return lexemeStream_;
+}
+
 void Compilation::AddError(std::string&& err)
 {
     errors_.emplace_back(std::move( err ));
@@ -1,11 +1,16 @@
 #pragma once
 
 #include <bitset>
+#include <optional>
+#include <set>
 #include <stack>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
+#include <output.h>
+
 namespace tusur
 {
 namespace compilers
@@ -36,6 +41,12 @@ struct Operation
     std::bitset<MAX_REGISTER_COUNT> registersUsed;
 };
 
+struct Lexeme
+{
+    LexemeType type;
+    std::string text;
+};
+
 class Compilation
 {
 public:
@@ -57,10 +68,58 @@ public:
 
     std::unordered_map<std::string, LexemeType> GetSymbolTable() const;
 
+    ///@brief Не генерировать код по ходу разбора, а только собирать поток лексем
+    ///
+    /// Нужно, чтобы сгенерировать код отдельно, например параллельно. Переключать до начала разбора.
+    void SetDeferredCodeGeneration(bool deferred);
+
+    ///@brief Поток лексем, собранный в режиме отложенной генерации кода
+    std::vector<Lexeme> const& GetLexemes() const;
+
+    ///@brief Лексемы подаются повторно из потока, который уже разобрал автомат, см. GenerateCode
+    ///
+    /// Такие лексемы посчитаны в статистике при разборе и второй раз не считаются.
+    void SetReplay(bool replay);
+
+    ///@brief Писать код в sink по мере свертки операций, а не собирать его на стеке
+    ///
+    /// На стеке остаются только операнды и номера временных ячеек, так что память ограничена вложенностью
+    /// выражения, а не размером кода. Операция пишется как LOAD lhs / ADD rhs / STORE $n в наименьшую свободную
+    /// ячейку, LOAD пропускается, если значение уже в аккумуляторе. Каждая инструкция завершается переводом строки.
+    /// Переключать до начала разбора.
+    /// GetCode и GetResult в этом режиме не имеют смысла.
+    void SetCodeSink(OutputWriter* sink);
+
+    ///@brief Результат генерации кода. Имеет смысл после GenerateRemainingCode
+    Operation GetResult() const;
+
+    ///@brief Код операции над уже сгенерированными операндами
+    static Operation Combine(LexemeType operation, Operation const& lhs, Operation const& rhs);
+
+    ///@brief Код цепочки operands[0] op operands[1] op ..., свернутой слева направо
+    ///
+    /// То же, что Combine по очереди, но накопленный код не копируется на каждом шаге: он попадает
+    /// в середину следующего, так что код цепочки собирается один раз после выбора регистров.
+    static Operation CombineChain(LexemeType operation, std::vector<Operation> const& operands);
+
 private:
     // Сгенерировать код на стеках без проверок стеков
     void GenerateCodeOnce();
 
+    // Операнд при потоковой генерации: переменная или литерал из таблицы символов либо временная ячейка
+    struct StreamOperand
+    {
+        std::string_view name;
+        int temp = -1;
+    };
+
+    // То же, что GenerateCodeOnce, но с выводом кода в sink_
+    void EmitCodeOnce();
+
+    void WriteOperand(StreamOperand const& operand);
+
+    size_t OperandCount() const;
+
 private:
     std::string currentLexeme_;
     std::unordered_map<std::string, LexemeType> symbolTable_;
@@ -70,7 +129,15 @@ private:
 
     // std::string code_;
 
-    // std::vector<??> lexemeStream_;
+    bool deferred_ = false;
+    bool replay_ = false;
+    std::vector<Lexeme> lexemeStream_;
+
+    OutputWriter* sink_ = nullptr;
+    std::vector<StreamOperand> operandStack_;
+    std::set<int> freeTemps_;
+    int nextTemp_ = 0;
+    int accumulatorTemp_ = -1; // ячейка, значение которой сейчас и в аккумуляторе
 };
 
 } // namespace compilers
@@ -0,0 +1,234 @@
+#include <expression.h>
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include <errors.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+namespace
+{
+
+bool IsOperand(LexemeType type)
+{
+    return type == Identifier || type == IntegerNumber || type == FloatingPointNumber;
+}
+
+bool IsLiteral(LexemeType type)
+{
+    return type == IntegerNumber || type == FloatingPointNumber;
+}
+
+} // namespace anonymous
+
+ExpressionTree::ExpressionTree(LexemeIterator first, LexemeIterator last)
+{
+    std::vector<size_t> operands;
+    std::vector<LexemeType> operations;
+
+    auto reduce = [&]
+    {
+        if( operands.size() < 2 )
+        {
+            throw CompilationError("Not enough operands on stack!");
+        }
+        const size_t rhs = operands.back();
+        operands.pop_back();
+        const size_t lhs = operands.back();
+        operands.pop_back();
+        operands.push_back(AddNode({ operations.back(), {}, lhs, rhs }));
+        operations.pop_back();
+    };
+
+    for( auto it = first; it != last; ++it )
+    {
+        switch( it->type )
+        {
+            case Identifier:
+            case IntegerNumber:
+            case FloatingPointNumber:
+                operands.push_back(AddNode({ it->type, it->text }));
+                break;
+            case PlusSign:
+            case MultipliesSign:
+                while( !operations.empty() && operations.back() != OpeningParentheses && it->type <= operations.back() )
+                {
+                    reduce();
+                }
+                operations.push_back(it->type);
+                break;
+            case OpeningParentheses:
+                operations.push_back(it->type);
+                break;
+            case ClosingParentheses:
+                while( !operations.empty() && operations.back() != OpeningParentheses )
+                {
+                    reduce();
+                }
+                if( operations.empty() )
+                {
+                    throw CompilationError("Unbalanced parentheses");
+                }
+                operations.pop_back();
+                break;
+            default:
+                throw CompilationError("Unexpected lexeme in expression: " + LexemeTypeToString(it->type));
+        }
+    }
+    while( !operations.empty() )
+    {
+        reduce();
+    }
+
+    if( operands.size() != 1 )
+    {
+        throw CompilationError("Malformed expression");
+    }
+    root_ = operands.back();
+}
+
+size_t ExpressionTree::AddNode(Node&& node)
+{
+    nodes_.push_back(std::move(node));
+    return nodes_.size() - 1;
+}
+
+ExpressionTree::Node const& ExpressionTree::GetNode(size_t index) const
+{
+    return nodes_[index];
+}
+
+size_t ExpressionTree::Root() const
+{
+    return root_;
+}
+
+size_t ExpressionTree::Size() const
+{
+    return nodes_.size();
+}
+
+size_t ExpressionTree::Depth() const
+{
+    size_t depth = 0;
+    std::vector<std::pair<size_t, size_t>> stack{ { root_, 1 } };
+    while( !stack.empty() )
+    {
+        auto [index, nodeDepth] = stack.back();
+        stack.pop_back();
+        depth = std::max(depth, nodeDepth);
+
+        auto const& node = nodes_[index];
+        if( !IsOperand(node.type) )
+        {
+            stack.emplace_back(node.lhs, nodeDepth + 1);
+            stack.emplace_back(node.rhs, nodeDepth + 1);
+        }
+    }
+    return depth;
+}
+
+void ExpressionTree::CollectChain(size_t root, std::vector<size_t>& operands, std::vector<size_t>& opNodes) const
+{
+    const auto type = nodes_[root].type;
+    std::vector<size_t> stack{ root };
+    while( !stack.empty() )
+    {
+        const size_t index = stack.back();
+        stack.pop_back();
+
+        auto const& node = nodes_[index];
+        if( node.type != type )
+        {
+            operands.push_back(index);
+            continue;
+        }
+        opNodes.push_back(index);
+        stack.push_back(node.rhs); // левый операнд обходим первым
+        stack.push_back(node.lhs);
+    }
+}
+
+void ExpressionTree::BuildBalanced(std::vector<size_t> const& operands, std::vector<size_t> const& opNodes)
+{
+    // Глубина рекурсии - логарифм длины цепочки
+    size_t nextOpNode = 0;
+    std::function<size_t(size_t, size_t)> build = [&](size_t begin, size_t end) -> size_t
+    {
+        if( end - begin == 1 )
+        {
+            return operands[begin];
+        }
+        const size_t index = opNodes[nextOpNode++];
+        const size_t middle = begin + (end - begin) / 2;
+        const size_t lhs = build(begin, middle);
+        const size_t rhs = build(middle, end);
+        nodes_[index].lhs = lhs;
+        nodes_[index].rhs = rhs;
+        return index;
+    };
+    build(0, operands.size());
+}
+
+void ExpressionTree::Reassociate(size_t minChainLength)
+{
+    std::vector<size_t> work{ root_ };
+    while( !work.empty() )
+    {
+        const size_t index = work.back();
+        work.pop_back();
+        if( IsOperand(nodes_[index].type) )
+        {
+            continue;
+        }
+
+        std::vector<size_t> operands, opNodes;
+        CollectChain(index, operands, opNodes);
+        if( operands.size() >= minChainLength )
+        {
+            // Литералы собираются в конце цепочки, чтобы оказаться в общих поддеревьях
+            std::stable_partition(operands.begin(), operands.end(),
+                                  [this](size_t operand){ return !IsLiteral(nodes_[operand].type); });
+            BuildBalanced(operands, opNodes);
+        }
+        work.insert(work.end(), operands.begin(), operands.end());
+    }
+}
+
+Operation ExpressionTree::GenerateCode() const
+{
+    std::vector<Operation> values;
+    std::vector<std::pair<size_t, bool>> stack{ { root_, false } }; // узел и признак того, что операнды уже обработаны
+    while( !stack.empty() )
+    {
+        auto [index, operandsDone] = stack.back();
+        stack.pop_back();
+
+        auto const& node = nodes_[index];
+        if( IsOperand(node.type) )
+        {
+            values.push_back({ node.text, {} });
+        }
+        else if( operandsDone )
+        {
+            auto rhs = std::move(values.back());
+            values.pop_back();
+            values.back() = Compilation::Combine(node.type, values.back(), rhs);
+        }
+        else
+        {
+            stack.emplace_back(index, true);
+            stack.emplace_back(node.rhs, false);
+            stack.emplace_back(node.lhs, false);
+        }
+    }
+    return std::move(values.back());
+}
+
+} // namespace compilers
+} // namespace tusur
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <codegen.h>
+#include <compilation.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+///@brief Дерево выражения
+///
+/// Узлы лежат в векторе и ссылаются друг на друга индексами, а все обходы сделаны без рекурсии:
+/// цепочка a + b + ... из миллиона операндов - это дерево глубины миллион.
+class ExpressionTree
+{
+public:
+    static constexpr size_t NoNode = static_cast<size_t>(-1);
+
+    struct Node
+    {
+        LexemeType type; // операция или тип операнда
+        std::string text; // для операндов
+        size_t lhs = NoNode;
+        size_t rhs = NoNode;
+    };
+
+    ///@brief Построить дерево выражения из лексем корректного выражения
+    ///
+    /// Операции с равным приоритетом связываются слева направо, как в Compilation::CompleteLexeme.
+    ExpressionTree(LexemeIterator first, LexemeIterator last);
+
+    ///@brief Глубина дерева, у одиночного операнда - 1
+    size_t Depth() const;
+
+    ///@brief Перестроить цепочки одной ассоциативной операции в сбалансированные деревья
+    ///
+    /// Меняет порядок вычислений, а значит, и округление чисел с плавающей точкой.
+    /// Операнды цепочки переупорядочиваются так, чтобы литералы шли подряд.
+    ///@param minChainLength Цепочки с меньшим числом операндов не трогаются
+    void Reassociate(size_t minChainLength = 3);
+
+    ///@brief Сгенерировать код для аккумуляторной машины так же, как это делает Compilation
+    Operation GenerateCode() const;
+
+    Node const& GetNode(size_t index) const;
+    size_t Root() const;
+
+    ///@brief Число узлов, индексы узлов меньше него
+    size_t Size() const;
+
+private:
+    size_t AddNode(Node&& node);
+
+    // Собрать слева направо операнды и узлы операций цепочки одной операции с вершиной в root
+    void CollectChain(size_t root, std::vector<size_t>& operands, std::vector<size_t>& opNodes) const;
+
+    // Собрать сбалансированное дерево из operands на узлах операций opNodes. Корнем остается opNodes[0]
+    void BuildBalanced(std::vector<size_t> const& operands, std::vector<size_t> const& opNodes);
+
+private:
+    std::vector<Node> nodes_;
+    size_t root_ = NoNode;
+};
+
+} // namespace compilers
+} // namespace tusur
@@ -19,6 +19,30 @@ bool is_alnum_us(char c)
     return std::isalnum(c) || c == '_';
 }
 
+std::uint64_t hash64(std::string_view data, std::uint64_t seed)
+{
+    std::uint64_t hash = seed;
+    for( unsigned char c : data )
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::vector<std::string> split(std::string_view data, char delimiter)
+{
+    std::vector<std::string> parts;
+    size_t begin = 0;
+    for( size_t end = data.find(delimiter); end != std::string_view::npos; end = data.find(delimiter, begin) )
+    {
+        parts.emplace_back(data.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    parts.emplace_back(data.substr(begin));
+    return parts;
+}
+
 } // namespace helpers
 } // namespace compilers
 } // namespace tusur
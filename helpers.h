@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
 namespace tusur
 {
 namespace compilers
@@ -13,6 +18,12 @@ bool is_alpha_us(char c);
 // Alphanumeric or underscore
 bool is_alnum_us(char c);
 
+// 64-битный хэш FNV-1a
+std::uint64_t hash64(std::string_view data, std::uint64_t seed = 14695981039346656037ull);
+
+// Разбить строку по разделителю, пустые части сохраняются
+std::vector<std::string> split(std::string_view data, char delimiter);
+
 } // namespace helpers
 } // namespace compilers
 } // namespace tusur
@@ -0,0 +1,663 @@
+#include <lab_one.h>
+
+#include <algorithm>
+#include <cctype>
+
+#include <automaton_table.h>
+#include <codegen.h>
+#include <expression.h>
+#include <helpers.h>
+#include <liveness.h>
+#include <recognizer.h>
+#include <register_machine.h>
+#include <report.h>
+#include <stats.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+using StackOfChars = std::stack<char>;
+
+template<typename C>
+void RegisterLabOneStates(PushdownAutomaton<C, char>& pda)
+{
+    namespace sn = state_names;
+    using std::pair, std::nullopt;
+
+    pda.RegisterTransition(sn::Begin, false,
+        [](char symbol, StackOfChars&, C& compilation) -> TransitionResult
+        {
+            if( std::isspace(symbol) )
+            {
+                return sn::Begin;
+            }
+            else if( helpers::is_alpha_us(symbol) )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::IdLvalueRest;
+            }
+            compilation.AddError("Invalid identifier. Has to begin with alphabetic symbol or underscore.");
+            return nullopt;
+        });
+
+    pda.RegisterTransition(sn::IdLvalueRest, false,
+        [](char symbol, StackOfChars&, C& compilation) -> TransitionResult
+        {
+            if( helpers::is_alnum_us(symbol) )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::IdLvalueRest;
+            }
+            else if( std::isspace(symbol) )
+            {
+                compilation.CompleteLexeme(LexemeType::Identifier);
+                return sn::LeftWhitespace;
+            }
+            else if( symbol == '=' )
+            {
+                compilation.CompleteLexeme(LexemeType::Identifier);
+                compilation.PushToLexeme(symbol);
+                compilation.CompleteLexeme(LexemeType::Assign);
+                return sn::Q;
+            }
+            compilation.AddError("Invalid identifier. Has to consist of alphanumeric symbols or underscore.");
+            return nullopt;
+        });
+
+    pda.RegisterTransition(sn::LeftWhitespace, false,
+        [](char symbol, StackOfChars&, C& compilation) -> TransitionResult
+        {
+            if( std::isspace(symbol) )
+            {
+                return sn::LeftWhitespace;
+            }
+            else if( symbol == '=' )
+            {
+                compilation.PushToLexeme(symbol);
+                compilation.CompleteLexeme(LexemeType::Assign);
+                return sn::Q;
+            }
+            compilation.AddError("Only assign \"=\" operator is allowed here.");
+            return nullopt;
+        });
+    pda.RegisterTransition(sn::Q, false,
+        [](char symbol, StackOfChars& stack, C& compilation) -> TransitionResult
+        {
+            if( symbol == '(' )
+            {
+                compilation.PushToLexeme(symbol);
+                compilation.CompleteLexeme(LexemeType::OpeningParentheses);
+
+                stack.emplace('(');
+                return sn::Q;
+            }
+            else if( std::isspace(symbol) )
+            {
+                return sn::Q;
+            }
+            else if( helpers::is_alpha_us(symbol) )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::Id;
+            }
+            else if( std::isdigit(symbol) )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::NumInt;
+            }
+            compilation.AddError("Should be an identifier, a number or (.");
+            return nullopt;
+        });
+
+    pda.RegisterTransition(sn::Id, true,
+        [](char symbol, StackOfChars& stack, C& compilation) -> TransitionResult
+        {
+            if( helpers::is_alnum_us(symbol) )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::Id;
+            }
+            else if( symbol == '*' || symbol == '+' )
+            {
+                compilation.CompleteLexeme(LexemeType::Identifier);
+                compilation.PushToLexeme(symbol);
+                compilation.CompleteLexeme( (symbol == '*')? LexemeType::MultipliesSign : LexemeType::PlusSign );
+                return sn::Q;
+            }
+            else if( std::isspace(symbol) )
+            {
+                compilation.CompleteLexeme(LexemeType::Identifier);
+                return sn::P;
+            }
+            else if( symbol == ')' && !stack.empty() && stack.top() == '(' )
+            {
+                compilation.CompleteLexeme(LexemeType::Identifier);
+                compilation.PushToLexeme(symbol);
+                compilation.CompleteLexeme(LexemeType::ClosingParentheses);
+
+                stack.pop();
+                return sn::P;
+            }
+            compilation.AddError("Should be an operator or ).");
+            return nullopt;
+        });
+    pda.RegisterTransition(sn::P, true,
+        [](char symbol, StackOfChars& stack, C& compilation) -> TransitionResult
+        {
+            if( std::isspace(symbol) )
+            {
+                return sn::P;
+            }
+            else if( symbol == ')' && !stack.empty() && stack.top() == '(' )
+            {
+                compilation.PushToLexeme(symbol);
+                compilation.CompleteLexeme(LexemeType::ClosingParentheses);
+
+                stack.pop();
+                return sn::P;
+            }
+            else if( symbol == '*' || symbol == '+' )
+            {
+                compilation.PushToLexeme(symbol);
+                compilation.CompleteLexeme( (symbol == '*')? LexemeType::MultipliesSign : LexemeType::PlusSign );
+
+                return sn::Q;
+            }
+            compilation.AddError("Should be an operator or ).");
+            return nullopt;
+        });
+
+    pda.RegisterTransition(sn::NumInt, true,
+        [](char symbol, StackOfChars& stack, C& compilation) -> TransitionResult
+        {
+            if( std::isdigit(symbol) )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::NumInt;
+            }
+            else if( symbol == '*' || symbol == '+' )
+            {
+                compilation.CompleteLexeme(LexemeType::IntegerNumber);
+                compilation.PushToLexeme(symbol);
+                compilation.CompleteLexeme( (symbol == '*')? LexemeType::MultipliesSign : LexemeType::PlusSign );
+                return sn::Q;
+            }
+            else if( symbol == ')' && !stack.empty() && stack.top() == '(' )
+            {
+                compilation.CompleteLexeme(LexemeType::IntegerNumber);
+                compilation.PushToLexeme(symbol);
+                compilation.CompleteLexeme(LexemeType::ClosingParentheses);
+
+                stack.pop();
+                return sn::P;
+            }
+            else if( std::isspace(symbol) )
+            {
+                compilation.CompleteLexeme(LexemeType::IntegerNumber);
+                return sn::P;
+            }
+            else if( symbol == '.' )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::Dot;
+            }
+            else if( symbol == 'e' || symbol == 'E' )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::ExpLetter;
+            }
+            compilation.AddError("Integer should either be followed by an operator or ) or become a float with E or \".\".");
+            return nullopt;
+        });
+
+    pda.RegisterTransition(sn::Dot, false,
+        [](char symbol, StackOfChars&, C& compilation) -> TransitionResult
+        {
+            if( std::isdigit(symbol) )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::NumFrac;
+            }
+            compilation.AddError("Only decimal part of the number is allowed here.");
+            return nullopt;
+        });
+
+    pda.RegisterTransition(sn::NumFrac, true,
+        [](char symbol, StackOfChars& stack, C& compilation) -> TransitionResult
+        {
+            if( std::isdigit(symbol) )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::NumFrac;
+            }
+            else if( symbol == '*' || symbol == '+' )
+            {
+                compilation.CompleteLexeme(LexemeType::FloatingPointNumber);
+                compilation.PushToLexeme(symbol);
+                compilation.CompleteLexeme( (symbol == '*')? LexemeType::MultipliesSign : LexemeType::PlusSign );
+
+                return sn::Q;
+            }
+            else if( symbol == ')' && !stack.empty() && stack.top() == '(' )
+            {
+                compilation.CompleteLexeme(LexemeType::FloatingPointNumber);
+                compilation.PushToLexeme(symbol);
+                compilation.CompleteLexeme(LexemeType::ClosingParentheses);
+
+                stack.pop();
+                return sn::P;
+            }
+            else if( std::isspace(symbol) )
+            {
+                compilation.CompleteLexeme(LexemeType::FloatingPointNumber);
+                return sn::P;
+            }
+            else if( symbol == 'e' || symbol == 'E' )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::ExpLetter;
+            }
+            compilation.AddError("Decimal number should either be an operator or ) or become a scientific with \"e\".");
+            return nullopt;
+        });
+
+    pda.RegisterTransition(sn::ExpLetter, false,
+        [](char symbol, StackOfChars&, C& compilation) -> TransitionResult
+        {
+            if( std::isdigit(symbol) )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::Exp;
+            }
+            else if( symbol == '+' || symbol == '-' )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::ExpSign;
+            }
+            compilation.AddError("Only signs + and - are allowed here.");
+            return nullopt;
+        });
+
+    pda.RegisterTransition(sn::ExpSign, false,
+        [](char symbol, StackOfChars&, C& compilation) -> TransitionResult
+        {
+            if( std::isdigit(symbol) )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::Exp;
+            }
+            compilation.AddError("Must be a number.");
+            return nullopt;
+        });
+
+    pda.RegisterTransition(sn::Exp, true,
+        [](char symbol, StackOfChars& stack, C& compilation) -> TransitionResult
+        {
+            if( std::isdigit(symbol) )
+            {
+                compilation.PushToLexeme(symbol);
+                return sn::Exp;
+            }
+            else if( std::isspace(symbol) )
+            {
+                compilation.CompleteLexeme(LexemeType::FloatingPointNumber);
+                return sn::P;
+            }
+            else if( symbol == ')' && !stack.empty() && stack.top() == '(' )
+            {
+                compilation.CompleteLexeme(LexemeType::FloatingPointNumber);
+                compilation.PushToLexeme(symbol);
+                compilation.CompleteLexeme(LexemeType::ClosingParentheses);
+
+                stack.pop();
+                return sn::P;
+            }
+            else if( symbol == '*' || symbol == '+' )
+            {
+                compilation.CompleteLexeme(LexemeType::FloatingPointNumber);
+                compilation.PushToLexeme(symbol);
+                compilation.CompleteLexeme( (symbol == '*')? LexemeType::MultipliesSign : LexemeType::PlusSign );
+
+                return sn::Q;
+            }
+            compilation.AddError("Should be an operator or ).");
+            return nullopt;
+        });
+
+    pda.SetFinalizer( [](char, std::string const& prevState, StackOfChars&, C& compilation)
+    {
+        // TODO: очень грязный код, отрефакторить
+        auto lexemeType = LexemeType::Assign;
+        if( prevState == sn::Id )
+        {
+            lexemeType = LexemeType::Identifier;
+        }
+        else if( prevState == sn::NumInt )
+        {
+            lexemeType = LexemeType::IntegerNumber;
+        }
+        else if( prevState == sn::NumFrac || prevState == sn::Exp )
+        {
+            lexemeType = LexemeType::FloatingPointNumber;
+        } // еще из конечных состояний есть P, но перед ним лексемы всегда коммитятся в compilation
+
+        if( lexemeType != LexemeType::Assign )
+        {
+            compilation.CompleteLexeme(lexemeType);
+        }
+    });
+}
+
+template void RegisterLabOneStates(PushdownAutomaton<Compilation, char>& pda);
+template void RegisterLabOneStates(PushdownAutomaton<RecordingContext, char>& pda);
+
+namespace
+{
+
+bool NeedsLexemeStream(CompileOptions const& options)
+{
+    return options.codegenThreads != 1 || options.reassociate || options.target == CodegenTarget::Register;
+}
+
+// Сгенерировать код выражения, которое автомат разобрал без ошибок
+CachedCompilation GenerateStatementCode(Compilation& compilation, CompileOptions const& options)
+{
+    LAB1C_STATS_TIMER(codegen);
+    CachedCompilation compiled;
+    compiled.symbolTable = compilation.GetSymbolTable();
+    auto const& lexemes = compilation.GetLexemes();
+    if( options.reassociate || options.target == CodegenTarget::Register )
+    {
+        // Лексемы начинаются с "идентификатор =", это гарантирует автомат
+        ExpressionTree tree(lexemes.begin() + 2, lexemes.end());
+        if( options.reassociate )
+        {
+            const size_t depthBefore = tree.Depth();
+            tree.Reassociate();
+            compiled.notes = "\nReassociation: tree depth " + std::to_string(depthBefore)
+                           + " -> " + std::to_string(tree.Depth()) + "\n";
+        }
+
+        if( options.target == CodegenTarget::Register )
+        {
+            const auto program = AllocateRegisters(LowerToRegisterCode(tree, lexemes[0].text));
+            const auto accumulatorCount = AccumulatorInstructionCount(tree);
+            compiled.code = program.ToString();
+            // У аккумуляторной машины каждая инструкция обращается к памяти
+            compiled.notes += "\nInstructions: register " + std::to_string(program.code.size())
+                            + ", accumulator " + std::to_string(accumulatorCount)
+                            + "\nMemory operations: register " + std::to_string(program.MemoryOperations())
+                            + ", accumulator " + std::to_string(accumulatorCount)
+                            + "\nSpilled registers: " + std::to_string(program.spilledRegisters) + "\n";
+        }
+        else
+        {
+            compiled.code = Compilation::Combine(Assign, { lexemes[0].text, {} }, tree.GenerateCode()).code;
+        }
+    }
+    else if( options.codegenThreads != 1 )
+    {
+        compiled.code = GenerateCodeParallel(lexemes, options.codegenThreads).code;
+    }
+    else if( !lexemes.empty() )
+    {
+        // Генерацию отложили ради анализа всей программы
+        compiled.code = GenerateCode(lexemes.begin(), lexemes.end()).code;
+    }
+    else
+    {
+        compilation.GenerateRemainingCode();
+        compiled.code = compilation.GetCode();
+    }
+    return compiled;
+}
+
+// Применить правку, превращающую текст recognizer в current: общие начало и конец не меняются
+RecognitionResult ApplyEdit(IncrementalRecognizer& recognizer, std::string_view current)
+{
+    std::string_view old = recognizer.Text();
+    const size_t prefix = std::mismatch(old.begin(), old.end(), current.begin(), current.end()).first - old.begin();
+    const size_t tailLimit = std::min(old.size(), current.size()) - prefix;
+    const size_t suffix = std::mismatch(old.rbegin(), old.rbegin() + tailLimit, current.rbegin()).first - old.rbegin();
+    return recognizer.Edit(prefix, old.size() - prefix - suffix, current.substr(prefix, current.size() - prefix - suffix));
+}
+
+} // namespace anonymous
+
+std::string CompileOptions::CacheKey() const
+{
+    std::string key = reassociate ? "reassociate" : "";
+    if( target == CodegenTarget::Register )
+    {
+        key += key.empty() ? "reg" : " reg";
+    }
+    return key;
+}
+
+template<typename Out>
+void CompileStatement(LabOneAutomaton& pda, std::string const& input, bool echoInput, Out& out,
+                      CompileOptions const& options, CompileCache* cache)
+{
+    std::optional<CachedCompilation> cached;
+    if( cache )
+    {
+        cached = cache->Find(input);
+    }
+    if( cached )
+    {
+        LAB1C_STATS_TIMER(output);
+        WritePdaResult(out, input, {Success, input.cend()}, std::nullopt, !echoInput);
+        out << '\n';
+        WriteCompilationResult(out, cached->code, cached->symbolTable);
+        out << cached->notes;
+        return;
+    }
+
+    Compilation compilation;
+    compilation.SetDeferredCodeGeneration(NeedsLexemeStream(options));
+    PdaResult result;
+    {
+        LAB1C_STATS_TIMER(automaton);
+        result = pda.ProcessText(input.cbegin(), input.cend(), state_names::Begin, compilation);
+    }
+
+    CachedCompilation compiled;
+    if( result.flags == Success )
+    {
+        compiled = GenerateStatementCode(compilation, options);
+    }
+
+    LAB1C_STATS_TIMER(output);
+    WritePdaResult(out, input, result, compilation.GetError(0), !echoInput);
+    out << '\n';
+    if( result.flags == Success )
+    {
+        WriteCompilationResult(out, compiled.code, compiled.symbolTable);
+        out << compiled.notes;
+        if( cache )
+        {
+            cache->Store(input, compiled);
+        }
+    }
+}
+
+template void CompileStatement(LabOneAutomaton& pda, std::string const& input, bool echoInput, OutputWriter& out,
+                               CompileOptions const& options, CompileCache* cache);
+template void CompileStatement(LabOneAutomaton& pda, std::string const& input, bool echoInput, StringOutput& out,
+                               CompileOptions const& options, CompileCache* cache);
+
+void CompileStatementStreaming(LabOneAutomaton& pda, std::string const& input, bool echoInput, OutputWriter& out)
+{
+    RecognitionResult recognition;
+    {
+        LAB1C_STATS_TIMER(automaton);
+        recognition = RecognizeLabOne(input);
+    }
+    if( recognition.flags != Success )
+    {
+        // Кода не будет, так что отчет об ошибке выводится как обычно
+        CompileStatement(pda, input, echoInput, out);
+        return;
+    }
+
+    {
+        LAB1C_STATS_TIMER(output);
+        WritePdaResult(out, input, { Success, input.cend() }, std::nullopt, !echoInput);
+        out << "\n\nCode:\n";
+    }
+
+    Compilation compilation;
+    compilation.SetCodeSink(&out);
+    {
+        LAB1C_STATS_TIMER(automaton);
+        pda.ProcessText(input.cbegin(), input.cend(), state_names::Begin, compilation);
+    }
+    {
+        LAB1C_STATS_TIMER(codegen);
+        compilation.GenerateRemainingCode();
+    }
+
+    LAB1C_STATS_TIMER(output);
+    WriteSymbolTable(out, compilation.GetSymbolTable());
+}
+
+void CheckStatement(std::string const& input, bool echoInput, OutputWriter& out)
+{
+    RecognitionResult result;
+    {
+        LAB1C_STATS_TIMER(automaton);
+        result = RecognizeLabOne(input);
+    }
+    LAB1C_STATS_DO( CurrentStats().bytesProcessed += result.errorOffset );
+
+    LAB1C_STATS_TIMER(output);
+    WritePdaResult(out, input, { result.flags, input.cbegin() + result.errorOffset }, std::nullopt, !echoInput);
+    out << '\n';
+}
+
+void CheckEdits(std::istream& in, bool echoInput, OutputWriter& out)
+{
+    IncrementalRecognizer recognizer;
+    bool isFirst = true;
+    std::string line;
+    while( true )
+    {
+        {
+            LAB1C_STATS_TIMER(reading);
+            if( !std::getline(in, line) )
+            {
+                break;
+            }
+        }
+
+        RecognitionResult result;
+        {
+            LAB1C_STATS_TIMER(automaton);
+            result = isFirst ? recognizer.Reset(line) : ApplyEdit(recognizer, line);
+            isFirst = false;
+        }
+        LAB1C_STATS_DO( CurrentStats().bytesProcessed += recognizer.BytesScanned() );
+
+        LAB1C_STATS_TIMER(output);
+        auto const& text = recognizer.Text();
+        WritePdaResult(out, text, { result.flags, text.cbegin() + result.errorOffset }, std::nullopt, !echoInput);
+        out << '\n';
+        out.Flush(); // редактор ждет ответа на каждую версию
+    }
+}
+
+void CompileProgram(LabOneAutomaton& pda, std::string const& program,
+                    std::optional<std::vector<std::string>> const& liveOutputs, OutputWriter& out,
+                    CompileOptions const& options, CompileCache* cache)
+{
+    struct Statement
+    {
+        size_t line;
+        std::string text;
+        Compilation compilation;
+    };
+
+    std::vector<Statement> statements;
+    std::vector<Assignment> assignments;
+    bool hasErrors = false;
+    const auto lines = helpers::split(program, '\n');
+    for( size_t i = 0; i < lines.size(); ++i )
+    {
+        auto const& line = lines[i];
+        if( std::all_of(line.begin(), line.end(), [](char c){ return std::isspace(c); }) )
+        {
+            continue;
+        }
+
+        Compilation compilation;
+        compilation.SetDeferredCodeGeneration(true); // код генерируется только для живых присваиваний
+        PdaResult result;
+        {
+            LAB1C_STATS_TIMER(automaton);
+            result = pda.ProcessText(line.cbegin(), line.cend(), state_names::Begin, compilation);
+        }
+        if( result.flags != Success )
+        {
+            // Отчет из одних ошибок, так что они выводятся сразу
+            LAB1C_STATS_TIMER(output);
+            out << "Line " << i + 1 << ":\n";
+            WritePdaResult(out, line, result, compilation.GetError(0), false);
+            out << '\n';
+            hasErrors = true;
+            continue;
+        }
+        assignments.push_back(MakeAssignment(compilation.GetLexemes()));
+        statements.push_back({ i + 1, line, std::move(compilation) });
+    }
+    if( hasErrors )
+    {
+        return;
+    }
+
+    const auto isLive = FindLiveAssignments(assignments, liveOutputs);
+    std::string code, notes, removed;
+    std::unordered_map<std::string, LexemeType> symbolTable;
+    for( size_t i = 0; i < statements.size(); ++i )
+    {
+        auto& statement = statements[i];
+        const auto lineName = std::to_string(statement.line);
+        if( !isLive[i] )
+        {
+            removed += "\t" + lineName + ": " + statement.text + "\n";
+            continue;
+        }
+
+        // Присваивание уже разобрано ради анализа живости, так что из кэша берется только сгенерированный код
+        std::optional<CachedCompilation> compiled;
+        if( cache )
+        {
+            compiled = cache->Find(statement.text);
+        }
+        if( !compiled )
+        {
+            compiled = GenerateStatementCode(statement.compilation, options);
+            if( cache )
+            {
+                cache->Store(statement.text, *compiled);
+            }
+        }
+
+        code += (code.empty() ? "" : "\n") + compiled->code;
+        symbolTable.insert(compiled->symbolTable.begin(), compiled->symbolTable.end());
+        if( !compiled->notes.empty() )
+        {
+            notes += "\nLine " + lineName + ":" + compiled->notes;
+        }
+    }
+
+    LAB1C_STATS_TIMER(output);
+    const auto removedCount = std::count(isLive.begin(), isLive.end(), false);
+    out << "Correct\n";
+    WriteCompilationResult(out, code, symbolTable);
+    out << notes << "\nRemoved dead statements: " << removedCount << '\n' << removed;
+}
+
+} // namespace compilers
+} // namespace tusur
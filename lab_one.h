@@ -0,0 +1,114 @@
+#pragma once
+
+#include <istream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <cache.h>
+#include <compilation.h>
+#include <output.h>
+#include <pda.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+namespace state_names
+{
+    inline const std::string Begin          = "Begin";
+    inline const std::string IdLvalueRest   = "IdLvalueRest";
+    inline const std::string LeftWhitespace = "LeftWhitespace";
+    inline const std::string Q              = "Q";
+    inline const std::string Id             = "Id";
+    inline const std::string P              = "P";
+    inline const std::string NumInt         = "NumInt";
+    inline const std::string Dot            = "Dot";
+    inline const std::string NumFrac        = "NumFrac";
+    inline const std::string ExpLetter      = "ExpLetter";
+    inline const std::string ExpSign        = "ExpSign";
+    inline const std::string Exp            = "Exp";
+} // namespace state_names
+
+using LabOneAutomaton = PushdownAutomaton<Compilation, char>;
+
+///@brief Целевая машина генерации кода
+enum class CodegenTarget
+{
+    Accumulator, // LOAD/STORE/ADD/MPY с одним аккумулятором
+    Register,    // трехадресный код на MAX_REGISTER_COUNT регистрах
+};
+
+///@brief Опции генерации кода
+struct CompileOptions
+{
+    unsigned codegenThreads = 1; // больше 1 - параллельная генерация, 0 - по числу ядер. Только для аккумулятора без reassociate
+    bool reassociate = false;    // балансировать цепочки + и *, меняет округление
+    CodegenTarget target = CodegenTarget::Accumulator;
+
+    ///@brief Опции, влияющие на сгенерированный код, для ключа кэша
+    std::string CacheKey() const;
+};
+
+///@brief Зарегистрировать состояния автомата первой лабораторной
+///
+/// Инстанцирована для Compilation и для RecordingContext, которым снимается таблица переходов
+template<typename C>
+void RegisterLabOneStates(PushdownAutomaton<C, char>& pda);
+
+///@brief Скомпилировать выражение и вывести отчет в том виде, в каком его печатает lab1c
+///
+/// Инстанцирована для OutputWriter и для StringOutput, которым отчет собирается в строку
+///@param pda Автомат с зарегистрированными состояниями
+///@param input Выражение
+///@param echoInput Выводить ли выражение перед результатом
+///@param out Вывод отчета
+///@param options Опции генерации кода
+///@param cache Кэш результатов компиляции, если есть
+template<typename Out>
+void CompileStatement(LabOneAutomaton& pda, std::string const& input, bool echoInput, Out& out,
+                      CompileOptions const& options = {}, CompileCache* cache = nullptr);
+
+///@brief Скомпилировать выражение, записывая код в out по ходу разбора, см. Compilation::SetCodeSink
+///
+/// Отчет того же вида, что у CompileStatement, но код не собирается в памяти целиком. Выражение сначала
+/// проверяется распознавателем, чтобы ошибка не оборвала уже выведенный код.
+///@param pda Автомат с зарегистрированными состояниями
+///@param input Выражение
+///@param echoInput Выводить ли выражение перед результатом
+///@param out Вывод отчета
+void CompileStatementStreaming(LabOneAutomaton& pda, std::string const& input, bool echoInput, OutputWriter& out);
+
+///@brief Только проверить выражение и вывести отчет об ошибке, не компилируя его, см. RecognizeLabOne
+///@param input Выражение
+///@param echoInput Выводить ли выражение перед результатом
+///@param out Вывод отчета
+void CheckStatement(std::string const& input, bool echoInput, OutputWriter& out);
+
+///@brief Проверять версии редактируемого выражения, по одной в строке, и выводить отчет на каждую
+///
+/// Правка - отличие строки от предыдущей без общих начала и конца. Строка проверяется IncrementalRecognizer,
+/// так что разбирается только окрестность правки. Отчет сбрасывается в out после каждой строки.
+///@param in Версии выражения
+///@param echoInput Выводить ли выражение перед результатом
+///@param out Вывод отчетов
+void CheckEdits(std::istream& in, bool echoInput, OutputWriter& out);
+
+///@brief Скомпилировать программу из присваиваний по одному в строке, удалив мертвые присваивания
+///
+/// Присваивание мертвое, если его значение перезаписывается раньше, чем читается, или не нужно после программы.
+/// Код генерируется только для живых присваиваний, удаленные перечисляются в отчете.
+///@param pda Автомат с зарегистрированными состояниями
+///@param program Текст программы, пустые строки пропускаются
+///@param liveOutputs Переменные, значения которых нужны после программы. std::nullopt - все присвоенные
+///@param out Вывод отчета
+///@param options Опции генерации кода
+///@param cache Кэш результатов компиляции отдельных присваиваний, если есть. Попадание в кэш экономит только
+///       генерацию кода: для поиска мертвых присваиваний каждое из них все равно разбирается автоматом
+void CompileProgram(LabOneAutomaton& pda, std::string const& program,
+                    std::optional<std::vector<std::string>> const& liveOutputs, OutputWriter& out,
+                    CompileOptions const& options = {}, CompileCache* cache = nullptr);
+
+} // namespace compilers
+} // namespace tusur
@@ -0,0 +1,62 @@
+#include <liveness.h>
+
+#include <unordered_set>
+
+#include <errors.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+Assignment MakeAssignment(std::vector<Lexeme> const& lexemes)
+{
+    // Лексемы начинаются с "идентификатор =", это гарантирует автомат
+    if( lexemes.size() < 2 || lexemes[0].type != Identifier || lexemes[1].type != Assign )
+    {
+        throw CompilationError("Statement has to be an assignment");
+    }
+
+    Assignment assignment{ lexemes[0].text, {} };
+    for( auto it = lexemes.begin() + 2; it != lexemes.end(); ++it )
+    {
+        if( it->type == Identifier )
+        {
+            assignment.uses.push_back(it->text);
+        }
+    }
+    return assignment;
+}
+
+std::vector<bool> FindLiveAssignments(std::vector<Assignment> const& program,
+                                      std::optional<std::vector<std::string>> const& liveOutputs)
+{
+    std::unordered_set<std::string> live;
+    if( liveOutputs )
+    {
+        live.insert(liveOutputs->begin(), liveOutputs->end());
+    }
+    else
+    {
+        for( auto const& assignment : program )
+        {
+            live.insert(assignment.target);
+        }
+    }
+
+    std::vector<bool> isLive(program.size(), false);
+    for( size_t i = program.size(); i-- > 0; )
+    {
+        auto const& assignment = program[i];
+        if( live.erase(assignment.target) == 0 )
+        {
+            continue; // значение перезапишут или оно не нужно
+        }
+        isLive[i] = true;
+        live.insert(assignment.uses.begin(), assignment.uses.end());
+    }
+    return isLive;
+}
+
+} // namespace compilers
+} // namespace tusur
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <compilation.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+///@brief Присваивание в терминах определений и использований переменных
+struct Assignment
+{
+    std::string target;
+    std::vector<std::string> uses; // идентификаторы правой части
+};
+
+///@brief Собрать определение и использования из лексем присваивания, см. Compilation::GetLexemes
+Assignment MakeAssignment(std::vector<Lexeme> const& lexemes);
+
+///@brief Найти присваивания, результат которых используется дальше или нужен после программы
+///
+/// Живость считается обратным проходом: присваивание живо, если его переменная жива после него,
+/// и тогда переменные правой части становятся живыми перед ним.
+///@param program Присваивания в порядке выполнения
+///@param liveOutputs Переменные, значения которых нужны после программы. std::nullopt - все присвоенные
+///@returns Для каждого присваивания, нужно ли оно
+std::vector<bool> FindLiveAssignments(std::vector<Assignment> const& program,
+                                      std::optional<std::vector<std::string>> const& liveOutputs);
+
+} // namespace compilers
+} // namespace tusur
@@ -1,485 +1,469 @@
 #include <algorithm>
+#include <charconv>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
+#include <iterator>
+#include <memory>
 
+#include <unistd.h>
+
+#include <automaton_table.h>
+#include <batch_reader.h>
+#include <cache.h>
 #include <compilation.h>
 #include <error.h>
 #include <helpers.h>
-#include <pda.h>
+#include <lab_one.h>
+#include <output.h>
+#include <report.h>
+#include <server.h>
+#include <stats.h>
 
 using namespace tusur::compilers;
 
-namespace
-{
-namespace state_names
-{
-    const std::string Begin          = "Begin";
-    const std::string IdLvalueRest   = "IdLvalueRest";
-    const std::string LeftWhitespace = "LeftWhitespace";
-    const std::string Q              = "Q";
-    const std::string Id             = "Id";
-    const std::string P              = "P";
-    const std::string NumInt         = "NumInt";
-    const std::string Dot            = "Dot";
-    const std::string NumFrac        = "NumFrac";
-    const std::string ExpLetter      = "ExpLetter";
-    const std::string ExpSign        = "ExpSign";
-    const std::string Exp            = "Exp";
-} // namespace state_names
-
-std::string PdaFlagsToString(int flags)
+struct ProgramData
 {
-    if( flags == PdaFlags::Success )
-    {
-        return "Success";
-    }
-
-    std::string ret;
-    if( flags & PdaFlags::StateIsNotFinal )
-    {
-        ret += "StateIsNotFinal ";
-    }
-    if( flags & PdaFlags::EndOfTextNotReached )
-    {
-        ret += "EndOfTextNotReached ";
-    }
-    if( flags & PdaFlags::StackIsNotEmpty )
-    {
-        ret += "StackIsNotEmpty ";
-    }
-
-    return ret;
-}
+    std::fstream inputFile;
+    std::vector<std::string> batchPaths; // несколько файлов или каталоги
+    std::optional<std::string> outputFile; // -o, по умолчанию stdout
+    std::optional<std::string> cacheDirectory;
+    std::uintmax_t cacheSizeLimit = 64 * 1024 * 1024;
+    std::optional<std::string> serverSocket;
+    unsigned workerCount = 0;
+    bool printStats = false;
+    CompileOptions compileOptions;
+    bool checkOnly = false;   // только проверить синтаксис, без компиляции
+    bool streaming = false;   // выводить код по ходу разбора, не собирая его в памяти
+    bool programMode = false; // весь вход - программа из присваиваний по одному в строке
+    bool followEdits = false; // строки входа - версии одного редактируемого выражения
+    bool printHelp = false;
+    std::optional<std::vector<std::string>> liveOutputs;
+    std::optional<std::string> tableFile;       // --table: переходы автомата из сохраненной таблицы
+    bool automatonReport = false;               // анализ графа состояний вместо компиляции
+    std::optional<std::string> automatonDot;
+    std::optional<std::string> automatonTable;  // куда сохранить минимизированную таблицу
+};
 
-std::string InterpretPdaResult(std::string& input, PdaResult res, std::optional<std::string> error, bool inputIsAtTerminal)
+const char* const Usage = R"(Usage: lab1c [options] [file | files and directories...]
+Compiles assignments "identifier = expression". Without files reads one statement from stdin,
+files and directories are compiled in batch, one statement per file.
+
+Modes:
+  --check                 only check the syntax
+  --edits                 check versions of one expression, one per line
+  --stream                write the code while parsing
+  --program               the input is a program of assignments, one per line
+  --live a,b,...          variables needed after the program, implies --program
+  --serve SOCKET          run a compile server on a Unix domain socket
+  --workers N             server worker threads, 0 - one per core
+  --automaton-report      analyze the automaton state graph
+  --automaton-dot FILE    write the state graph for Graphviz
+  --automaton-table FILE  save the minimized transition table
+
+Code generation:
+  --reassociate           balance long + and * chains
+  --parallel N            generate top-level operands in N threads, 0 - one per core
+  --target acc|reg        accumulator or register machine code
+  --table FILE            take the automaton transitions from a saved table
+
+Other:
+  --cache DIR             on-disk compile cache
+  --cache-size BYTES      cache size limit, 64 MiB by default
+  -o FILE                 write the output to FILE
+  --stats                 print counters and timers as JSON to stderr
+  -h, --help              show this help
+)";
+
+// Неотрицательное целое значение опции
+template<typename T>
+T ParseNumber(std::string const& option, std::string const& value)
 {
-    std::string output;
-    if( !inputIsAtTerminal )
-    {
-        output += input + "\n";
-    }
-
-    auto [flags, iter] = res;
-    if( flags == PdaFlags::Success )
-    {
-        output += "Correct";
-        return output;
-    }
-
-    const size_t symbolPos = iter - input.begin();
-    for( size_t i = 0; i < symbolPos; ++i )
+    T number{};
+    auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), number);
+    if( ec != std::errc() || end != value.data() + value.size() )
     {
-        output.push_back(' ');
+        throw std::runtime_error("Invalid value for " + option + ": " + value + ", expected a non-negative integer");
     }
-
-    const std::string errorMsg = error.has_value()
-                                 ? " " + error.value()
-                                 : "";
-    output += "^" + errorMsg + " PDA flags: " + PdaFlagsToString(flags);
-
-    return output;
+    return number;
 }
 
-} // namespace anonymous
-
-using StackOfChars = std::stack<char>;
-
-void RegisterLabOneStates(PushdownAutomaton<Compilation, char>& pda)
+ProgramData ProcessArgs(int argc, char** argv)
 {
-    namespace sn = state_names;
-    using std::pair, std::nullopt;
+    ProgramData data;
+    for( int i = 1; i < argc; ++i )
+    {
+        std::string arg(argv[i]);
 
-    pda.RegisterTransition(sn::Begin, false,
-        [](char symbol, StackOfChars&, Compilation& compilation) -> TransitionResult
+        if( arg == "-h" || arg == "--help" )
         {
-            if( std::isspace(symbol) )
-            {
-                return sn::Begin;
-            }
-            else if( helpers::is_alpha_us(symbol) )
-            {
-                compilation.PushToLexeme(symbol);
-                return sn::IdLvalueRest;
-            }
-            compilation.AddError("Invalid identifier. Has to begin with alphabetic symbol or underscore.");
-            return nullopt;
-        });
-
-    pda.RegisterTransition(sn::IdLvalueRest, false,
-        [](char symbol, StackOfChars&, Compilation& compilation) -> TransitionResult
+            data.printHelp = true;
+            return data;
+        }
+        else if( arg == "--stats" )
         {
-            if( helpers::is_alnum_us(symbol) )
-            {
-                compilation.PushToLexeme(symbol);
-                return sn::IdLvalueRest;
-            }
-            else if( std::isspace(symbol) )
-            {
-                compilation.CompleteLexeme(LexemeType::Identifier);
-                return sn::LeftWhitespace;
-            }
-            else if( symbol == '=' )
-            {
-                compilation.CompleteLexeme(LexemeType::Identifier);
-                compilation.PushToLexeme(symbol);
-                compilation.CompleteLexeme(LexemeType::Assign);
-                return sn::Q;
-            }
-            compilation.AddError("Invalid identifier. Has to consist of alphanumeric symbols or underscore.");
-            return nullopt;
-        });
-
-    pda.RegisterTransition(sn::LeftWhitespace, false,
-        [](char symbol, StackOfChars&, Compilation& compilation) -> TransitionResult
+#ifndef LAB1C_STATS
+            throw std::runtime_error("--stats is not available: lab1c is built without LAB1C_STATS");
+#endif
+            data.printStats = true;
+            LAB1C_STATS_DO( EnableAllocationCounting() );
+        }
+        else if( arg == "--reassociate" )
         {
-            if( std::isspace(symbol) )
-            {
-                return sn::LeftWhitespace;
-            }
-            else if( symbol == '=' )
-            {
-                compilation.PushToLexeme(symbol);
-                compilation.CompleteLexeme(LexemeType::Assign);
-                return sn::Q;
-            }
-            compilation.AddError("Only assign \"=\" operator is allowed here.");
-            return nullopt;
-        });
-    pda.RegisterTransition(sn::Q, false,
-        [](char symbol, StackOfChars& stack, Compilation& compilation) -> TransitionResult
+            data.compileOptions.reassociate = true;
+        }
+        else if( arg == "--check" )
         {
-            if( symbol == '(' )
-            {
-                compilation.PushToLexeme(symbol);
-                compilation.CompleteLexeme(LexemeType::OpeningParentheses);
-
-                stack.emplace('(');
-                return sn::Q;
-            }
-            else if( std::isspace(symbol) )
-            {
-                return sn::Q;
-            }
-            else if( helpers::is_alpha_us(symbol) )
-            {
-                compilation.PushToLexeme(symbol);
-                return sn::Id;
-            }
-            else if( std::isdigit(symbol) )
-            {
-                compilation.PushToLexeme(symbol);
-                return sn::NumInt;
-            }
-            compilation.AddError("Should be an identifier, a number or (.");
-            return nullopt;
-        });
-
-    pda.RegisterTransition(sn::Id, true,
-        [](char symbol, StackOfChars& stack, Compilation& compilation) -> TransitionResult
+            data.checkOnly = true;
+        }
+        else if( arg == "--stream" )
         {
-            if( helpers::is_alnum_us(symbol) )
-            {
-                compilation.PushToLexeme(symbol);
-                return sn::Id;
-            }
-            else if( symbol == '*' || symbol == '+' )
-            {
-                compilation.CompleteLexeme(LexemeType::Identifier);
-                compilation.PushToLexeme(symbol);
-                compilation.CompleteLexeme( (symbol == '*')? LexemeType::MultipliesSign : LexemeType::PlusSign );
-                return sn::Q;
-            }
-            else if( std::isspace(symbol) )
-            {
-                compilation.CompleteLexeme(LexemeType::Identifier);
-                return sn::P;
-            }
-            else if( symbol == ')' && !stack.empty() && stack.top() == '(' )
-            {
-                compilation.CompleteLexeme(LexemeType::Identifier);
-                compilation.PushToLexeme(symbol);
-                compilation.CompleteLexeme(LexemeType::ClosingParentheses);
-
-                stack.pop();
-                return sn::P;
-            }
-            compilation.AddError("Should be an operator or ).");
-            return nullopt;
-        });
-    pda.RegisterTransition(sn::P, true,
-        [](char symbol, StackOfChars& stack, Compilation& compilation) -> TransitionResult
+            data.streaming = true;
+        }
+        else if( arg == "--program" )
         {
-            if( std::isspace(symbol) )
-            {
-                return sn::P;
-            }
-            else if( symbol == ')' && !stack.empty() && stack.top() == '(' )
-            {
-                compilation.PushToLexeme(symbol);
-                compilation.CompleteLexeme(LexemeType::ClosingParentheses);
-
-                stack.pop();
-                return sn::P;
-            }
-            else if( symbol == '*' || symbol == '+' )
-            {
-                compilation.PushToLexeme(symbol);
-                compilation.CompleteLexeme( (symbol == '*')? LexemeType::MultipliesSign : LexemeType::PlusSign );
-
-                return sn::Q;
-            }
-            compilation.AddError("Should be an operator or ).");
-            return nullopt;
-        });
-
-    pda.RegisterTransition(sn::NumInt, true,
-        [](char symbol, StackOfChars& stack, Compilation& compilation) -> TransitionResult
+            data.programMode = true;
+        }
+        else if( arg == "--edits" )
         {
-            if( std::isdigit(symbol) )
-            {
-                compilation.PushToLexeme(symbol);
-                return sn::NumInt;
-            }
-            else if( symbol == '*' || symbol == '+' )
+            data.followEdits = true;
+            data.checkOnly = true;
+        }
+        else if( arg == "--automaton-report" )
+        {
+            data.automatonReport = true;
+        }
+        else if( arg == "-o" || arg.starts_with("--") ) // остальные опции со значением
+        {
+            if( ++i >= argc )
             {
-                compilation.CompleteLexeme(LexemeType::IntegerNumber);
-                compilation.PushToLexeme(symbol);
-                compilation.CompleteLexeme( (symbol == '*')? LexemeType::MultipliesSign : LexemeType::PlusSign );
-                return sn::Q;
+                throw std::runtime_error("Missing value for " + arg);
             }
-            else if( symbol == ')' && !stack.empty() && stack.top() == '(' )
-            {
-                compilation.CompleteLexeme(LexemeType::IntegerNumber);
-                compilation.PushToLexeme(symbol);
-                compilation.CompleteLexeme(LexemeType::ClosingParentheses);
+            const std::string value(argv[i]);
 
-                stack.pop();
-                return sn::P;
-            }
-            else if( std::isspace(symbol) )
+            if( arg == "-o" )
             {
-                compilation.CompleteLexeme(LexemeType::IntegerNumber);
-                return sn::P;
+                data.outputFile = value;
             }
-            else if( symbol == '.' )
+            else if( arg == "--cache" )
             {
-                compilation.PushToLexeme(symbol);
-                return sn::Dot;
+                data.cacheDirectory = value;
             }
-            else if( symbol == 'e' || symbol == 'E' )
+            else if( arg == "--cache-size" )
             {
-                compilation.PushToLexeme(symbol);
-                return sn::ExpLetter;
+                data.cacheSizeLimit = ParseNumber<std::uintmax_t>(arg, value);
             }
-            compilation.AddError("Integer should either be followed by an operator or ) or become a float with E or \".\".");
-            return nullopt;
-        });
-
-    pda.RegisterTransition(sn::Dot, false,
-        [](char symbol, StackOfChars&, Compilation& compilation) -> TransitionResult
-        {
-            if( std::isdigit(symbol) )
+            else if( arg == "--serve" )
             {
-                compilation.PushToLexeme(symbol);
-                return sn::NumFrac;
+                data.serverSocket = value;
             }
-            compilation.AddError("Only decimal part of the number is allowed here.");
-            return nullopt;
-        });
-
-    pda.RegisterTransition(sn::NumFrac, true,
-        [](char symbol, StackOfChars& stack, Compilation& compilation) -> TransitionResult
-        {
-            if( std::isdigit(symbol) )
+            else if( arg == "--workers" )
             {
-                compilation.PushToLexeme(symbol);
-                return sn::NumFrac;
+                data.workerCount = ParseNumber<unsigned>(arg, value);
             }
-            else if( symbol == '*' || symbol == '+' )
+            else if( arg == "--parallel" )
             {
-                compilation.CompleteLexeme(LexemeType::FloatingPointNumber);
-                compilation.PushToLexeme(symbol);
-                compilation.CompleteLexeme( (symbol == '*')? LexemeType::MultipliesSign : LexemeType::PlusSign );
-
-                return sn::Q;
+                data.compileOptions.codegenThreads = ParseNumber<unsigned>(arg, value);
             }
-            else if( symbol == ')' && !stack.empty() && stack.top() == '(' )
+            else if( arg == "--live" )
             {
-                compilation.CompleteLexeme(LexemeType::FloatingPointNumber);
-                compilation.PushToLexeme(symbol);
-                compilation.CompleteLexeme(LexemeType::ClosingParentheses);
-
-                stack.pop();
-                return sn::P;
+                data.liveOutputs = helpers::split(value, ',');
+                data.programMode = true;
             }
-            else if( std::isspace(symbol) )
+            else if( arg == "--table" )
             {
-                compilation.CompleteLexeme(LexemeType::FloatingPointNumber);
-                return sn::P;
+                data.tableFile = value;
             }
-            else if( symbol == 'e' || symbol == 'E' )
+            else if( arg == "--automaton-dot" )
             {
-                compilation.PushToLexeme(symbol);
-                return sn::ExpLetter;
+                data.automatonDot = value;
             }
-            compilation.AddError("Decimal number should either be an operator or ) or become a scientific with \"e\".");
-            return nullopt;
-        });
-
-    pda.RegisterTransition(sn::ExpLetter, false,
-        [](char symbol, StackOfChars&, Compilation& compilation) -> TransitionResult
-        {
-            if( std::isdigit(symbol) )
+            else if( arg == "--automaton-table" )
             {
-                compilation.PushToLexeme(symbol);
-                return sn::Exp;
+                data.automatonTable = value;
             }
-            else if( symbol == '+' || symbol == '-' )
+            else if( arg == "--target" )
             {
-                compilation.PushToLexeme(symbol);
-                return sn::ExpSign;
+                if( value != "acc" && value != "reg" )
+                {
+                    throw std::runtime_error("Unknown target " + value + ", expected acc or reg");
+                }
+                data.compileOptions.target = value == "reg" ? CodegenTarget::Register : CodegenTarget::Accumulator;
             }
-            compilation.AddError("Only signs + and - are allowed here.");
-            return nullopt;
-        });
-
-    pda.RegisterTransition(sn::ExpSign, false,
-        [](char symbol, StackOfChars&, Compilation& compilation) -> TransitionResult
-        {
-            if( std::isdigit(symbol) )
+            else
             {
-                compilation.PushToLexeme(symbol);
-                return sn::Exp;
+                throw std::runtime_error("Unknown option " + arg);
             }
-            compilation.AddError("Must be a number.");
-            return nullopt;
-        });
-
-    pda.RegisterTransition(sn::Exp, true,
-        [](char symbol, StackOfChars& stack, Compilation& compilation) -> TransitionResult
+        }
+        else
         {
-            if( std::isdigit(symbol) )
-            {
-                compilation.PushToLexeme(symbol);
-                return sn::Exp;
-            }
-            else if( std::isspace(symbol) )
-            {
-                compilation.CompleteLexeme(LexemeType::FloatingPointNumber);
-                return sn::P;
-            }
-            else if( symbol == ')' && !stack.empty() && stack.top() == '(' )
-            {
-                compilation.CompleteLexeme(LexemeType::FloatingPointNumber);
-                compilation.PushToLexeme(symbol);
-                compilation.CompleteLexeme(LexemeType::ClosingParentheses);
+            data.batchPaths.push_back(arg);
+        }
+    }
 
-                stack.pop();
-                return sn::P;
-            }
-            else if( symbol == '*' || symbol == '+' )
-            {
-                compilation.CompleteLexeme(LexemeType::FloatingPointNumber);
-                compilation.PushToLexeme(symbol);
-                compilation.CompleteLexeme( (symbol == '*')? LexemeType::MultipliesSign : LexemeType::PlusSign );
+    if( data.checkOnly && data.programMode )
+    {
+        throw std::runtime_error("--check is not supported with --program");
+    }
+    auto const& options = data.compileOptions;
+    if( options.codegenThreads != 1 && (options.reassociate || options.target != CodegenTarget::Accumulator) )
+    {
+        // Переставленное дерево и регистровый код строятся целиком в одном потоке
+        throw std::runtime_error("--parallel is not supported with --reassociate or --target reg");
+    }
+    if( data.streaming && (data.checkOnly || data.programMode || data.cacheDirectory || options.reassociate
+                           || options.codegenThreads != 1 || options.target != CodegenTarget::Accumulator) )
+    {
+        throw std::runtime_error("--stream supports only the default accumulator code generation");
+    }
 
-                return sn::Q;
-            }
-            compilation.AddError("Should be an operator or ).");
-            return nullopt;
-        });
+    if( data.serverSocket && (data.tableFile || data.cacheDirectory || data.checkOnly || data.streaming || data.programMode) )
+    {
+        throw std::runtime_error("--serve supports only code generation options: --reassociate, --parallel, --target");
+    }
 
-    pda.SetFinalizer( [](char, std::string const& prevState, StackOfChars&, Compilation& compilation)
+    if( data.batchPaths.size() == 1 && !std::filesystem::is_directory(data.batchPaths.front()) )
     {
-        // TODO: очень грязный код, отрефакторить
-        auto lexemeType = LexemeType::Assign;
-        if( prevState == sn::Id )
+        data.inputFile.open(data.batchPaths.front());
+        if( !data.inputFile.good() )
         {
-            lexemeType = LexemeType::Identifier;
+            throw std::runtime_error("Couldn't open file");
         }
-        else if( prevState == sn::NumInt )
-        {
-            lexemeType = LexemeType::IntegerNumber;
-        }
-        else if( prevState == sn::NumFrac || prevState == sn::Exp )
-        {
-            lexemeType = LexemeType::FloatingPointNumber;
-        } // еще из конечных состояний есть P, но перед ним лексемы всегда коммитятся в compilation
+        data.batchPaths.clear();
+    }
+    if( data.followEdits && !data.batchPaths.empty() )
+    {
+        throw std::runtime_error("--edits reads a single file or stdin");
+    }
 
-        if( lexemeType != LexemeType::Assign )
-        {
-            compilation.CompleteLexeme(lexemeType);
-        }
-    });
+    return data;
 }
 
-struct ProgramData
+TransitionTable ReadTable(std::string const& path)
 {
-    std::fstream inputFile;
-    // TODO: добавить файл вывода с опцией -o
-};
+    std::ifstream file(path);
+    if( !file.good() )
+    {
+        throw std::runtime_error("Couldn't open automaton table " + path);
+    }
+    return LoadTable(file);
+}
 
-ProgramData ProcessArgs(int argc, char** argv)
+// Снять граф состояний автомата (или взять из --table), вывести сводку, DOT и минимизированную таблицу
+void AnalyzeAutomaton(ProgramData const& data)
 {
-    ProgramData data;
-    for( int i = 1; i < argc; ++i )
+    TransitionTable table;
+    if( data.tableFile )
     {
-        std::string arg(argv[i]);
-        // TODO: обработка -h и прочих
+        table = ReadTable(*data.tableFile);
+    }
+    else
+    {
+        ProbeAutomaton probe;
+        RegisterLabOneStates(probe);
+        table = ExtractTable(probe, state_names::Begin);
+    }
+    const auto minimal = MinimizeTable(table);
 
-        if( !data.inputFile.is_open() )
+    if( data.automatonDot )
+    {
+        std::ofstream file(*data.automatonDot);
+        if( !(file << TableToDot(table)) )
         {
-            data.inputFile.open(arg);
-            if( !data.inputFile.good() )
-            {
-                throw std::runtime_error("Couldn't open file");
-            }
+            throw std::runtime_error("Couldn't write " + *data.automatonDot);
         }
     }
-
-    return data;
+    if( data.automatonTable )
+    {
+        std::ofstream file(*data.automatonTable);
+        SaveTable(minimal, file);
+        if( !file )
+        {
+            throw std::runtime_error("Couldn't write " + *data.automatonTable);
+        }
+    }
+    if( data.automatonReport )
+    {
+        auto out = data.outputFile ? std::make_unique<OutputWriter>(*data.outputFile)
+                                   : std::make_unique<OutputWriter>(STDOUT_FILENO);
+        *out << FormatTableReport(table, AnalyzeStateGraph(table), minimal);
+    }
 }
 
 int main(int argc, char** argv)
 {
+    // stdout пишется через OutputWriter мимо stdio, а std::cin и std::cerr не смешиваются с printf
+    std::ios::sync_with_stdio(false);
+
     try
     {
         auto programData = ProcessArgs(argc, argv);
+        if( programData.printHelp )
+        {
+            std::cout << Usage;
+            return 0;
+        }
 
-        Compilation compilation;
-        PushdownAutomaton<Compilation, char> pda;
-        RegisterLabOneStates(pda);
+        if( programData.automatonReport || programData.automatonDot || programData.automatonTable )
+        {
+            AnalyzeAutomaton(programData);
+            return 0;
+        }
+
+        if( programData.serverSocket )
+        {
+            if( programData.printStats )
+            {
+                throw std::runtime_error("--stats is not supported with --serve");
+            }
+            RunServer({ *programData.serverSocket, programData.workerCount, programData.compileOptions });
+            return 0;
+        }
 
-        std::string input;
-        bool inputIsAtTerminal = false;
-        if( programData.inputFile.is_open() )
+        LabOneAutomaton pda;
+        if( programData.tableFile )
         {
-            std::getline(programData.inputFile, input);
+            RegisterTableStates(pda, ReadTable(*programData.tableFile));
         }
         else
         {
-            std::getline(std::cin, input);
-            inputIsAtTerminal = true;
+            RegisterLabOneStates(pda);
         }
 
-        auto result = pda.ProcessText(input.cbegin(), input.cend(), state_names::Begin, compilation);
+        std::unique_ptr<CompileCache> cache;
+        if( programData.cacheDirectory )
+        {
+            cache = std::make_unique<CompileCache>(*programData.cacheDirectory, programData.cacheSizeLimit,
+                                                   programData.compileOptions.CacheKey());
+        }
+
+        auto writer = programData.outputFile ? std::make_unique<OutputWriter>(*programData.outputFile)
+                                             : std::make_unique<OutputWriter>(STDOUT_FILENO);
+        OutputWriter& out = *writer;
 
-        if( result.flags == Success ) // TODO: очень грязный наколеночный код, переписать чисто
+        if( !programData.batchPaths.empty() )
         {
-            compilation.GenerateRemainingCode();
+            // Компиляция очередного файла идет, пока читаются следующие
+            BatchReader reader(ExpandPaths(programData.batchPaths));
+            size_t fileCount = 0;
+            while( true )
+            {
+                std::optional<SourceFile> file;
+                {
+                    LAB1C_STATS_TIMER(reading);
+                    file = reader.Next();
+                }
+                if( !file )
+                {
+                    break;
+                }
+
+                ++fileCount;
+                {
+                    LAB1C_STATS_TIMER(output);
+                    out << "File: " << file->name << '\n';
+                }
+                if( !programData.programMode )
+                {
+                    // Выражение в файле одно, остальные строки не читаются
+                    file->content.resize(std::min(file->content.find('\n'), file->content.size()));
+                }
+
+                if( file->error )
+                {
+                    LAB1C_STATS_TIMER(output);
+                    out << "Error: " << *file->error << '\n';
+                }
+                else if( programData.streaming )
+                {
+                    CompileStatementStreaming(pda, file->content, true, out);
+                }
+                else if( programData.checkOnly )
+                {
+                    CheckStatement(file->content, true, out);
+                }
+                else if( programData.programMode )
+                {
+                    CompileProgram(pda, file->content, programData.liveOutputs, out,
+                                   programData.compileOptions, cache.get());
+                }
+                else
+                {
+                    CompileStatement(pda, file->content, true, out, programData.compileOptions, cache.get());
+                }
+                out << '\n';
+            }
+            {
+                LAB1C_STATS_TIMER(output);
+                out.Flush();
+            }
+            std::cerr << "lab1c: " << fileCount << " file(s) read via " << reader.LoaderName() << std::endl;
         }
+        else if( programData.programMode )
+        {
+            std::string program;
+            {
+                LAB1C_STATS_TIMER(reading);
+                std::istream& in = programData.inputFile.is_open() ? programData.inputFile : std::cin;
+                program.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            }
 
-        std::cout << InterpretPdaResult(input, result, compilation.GetError(0), inputIsAtTerminal) << std::endl;
+            CompileProgram(pda, program, programData.liveOutputs, out, programData.compileOptions, cache.get());
 
-        if( result.flags == Success )
+            LAB1C_STATS_TIMER(output);
+            out.Flush();
+        }
+        else if( programData.followEdits )
+        {
+            const bool inputIsAtTerminal = !programData.inputFile.is_open();
+            CheckEdits(inputIsAtTerminal ? std::cin : programData.inputFile, !inputIsAtTerminal, out);
+        }
+        else
         {
-            std::cout << "\nCode:\n" << compilation.GetCode() << std::endl;
-            auto symbolTable = compilation.GetSymbolTable();
-            std::cout << "\nSymbol table:\n";
-            std::for_each(symbolTable.begin(), symbolTable.end(), [](auto& symbol)
+            std::string input;
+            bool inputIsAtTerminal = false;
             {
-                std::cout << "\t" << LexemeTypeToString(symbol.second) << " " << symbol.first << "\n";
-            });
+                LAB1C_STATS_TIMER(reading);
+                if( programData.inputFile.is_open() )
+                {
+                    std::getline(programData.inputFile, input);
+                }
+                else
+                {
+                    std::getline(std::cin, input);
+                    inputIsAtTerminal = true;
+                }
+            }
+
+            if( programData.streaming )
+            {
+                CompileStatementStreaming(pda, input, !inputIsAtTerminal, out);
+                out.Flush();
+            }
+            else
+            {
+                if( programData.checkOnly )
+                {
+                    CheckStatement(input, !inputIsAtTerminal, out);
+                }
+                else
+                {
+                    CompileStatement(pda, input, !inputIsAtTerminal, out, programData.compileOptions, cache.get());
+                }
+
+                LAB1C_STATS_TIMER(output);
+                out.Flush();
+            }
+        }
+
+        if( cache )
+        {
+            std::cerr << "Cache: " << cache->Hits() << " hit(s), " << cache->Misses() << " miss(es)" << std::endl;
+        }
+
+        if( programData.printStats )
+        {
+            LAB1C_STATS_DO( pda.CollectStats(CurrentStats()); std::cerr << StatsToJson(CurrentStats()) );
         }
 
         return 0;
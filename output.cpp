@@ -0,0 +1,139 @@
+#include <output.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+OutputWriter::OutputWriter(int fd, size_t capacity)
+    : fd_(fd)
+    , ownsFd_(false)
+    , buffer_(capacity)
+{
+}
+
+OutputWriter::OutputWriter(std::string const& path, size_t capacity)
+    : fd_(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644))
+    , ownsFd_(true)
+    , buffer_(capacity)
+{
+    if( fd_ < 0 )
+    {
+        throw std::system_error(errno, std::generic_category(), "Couldn't open output file " + path);
+    }
+}
+
+OutputWriter::~OutputWriter()
+{
+    try
+    {
+        Flush();
+    }
+    catch(std::system_error&)
+    {
+    }
+    if( ownsFd_ )
+    {
+        ::close(fd_);
+    }
+}
+
+OutputWriter& OutputWriter::operator<<(std::string_view text)
+{
+    if( text.size() > buffer_.size() - size_ )
+    {
+        WriteThrough(text);
+        return *this;
+    }
+    std::memcpy(buffer_.data() + size_, text.data(), text.size());
+    size_ += text.size();
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(char symbol)
+{
+    if( size_ == buffer_.size() )
+    {
+        Flush();
+    }
+    buffer_[size_++] = symbol;
+    return *this;
+}
+
+OutputWriter& OutputWriter::Repeat(char symbol, size_t count)
+{
+    while( count > 0 )
+    {
+        if( size_ == buffer_.size() )
+        {
+            Flush();
+        }
+        const size_t chunk = std::min(count, buffer_.size() - size_);
+        std::memset(buffer_.data() + size_, symbol, chunk);
+        size_ += chunk;
+        count -= chunk;
+    }
+    return *this;
+}
+
+void OutputWriter::Flush()
+{
+    WriteThrough({});
+}
+
+void OutputWriter::WriteThrough(std::string_view text)
+{
+    iovec parts[2] = {
+        { buffer_.data(), size_ },
+        { const_cast<char*>(text.data()), text.size() },
+    };
+    iovec* first = parts;
+    int count = 2;
+    while( count > 0 )
+    {
+        if( first->iov_len == 0 )
+        {
+            ++first;
+            --count;
+            continue;
+        }
+
+        const ssize_t written = ::writev(fd_, first, count);
+        if( written < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            size_ = 0; // недописанное уже не отправить, а буфер нужен для следующих записей
+            throw std::system_error(errno, std::generic_category(), "Couldn't write output");
+        }
+
+        // Частичная запись: пропустить отправленное
+        for( size_t rest = written; rest > 0; )
+        {
+            const size_t skip = std::min(rest, first->iov_len);
+            first->iov_base = static_cast<char*>(first->iov_base) + skip;
+            first->iov_len -= skip;
+            rest -= skip;
+            if( first->iov_len == 0 && rest > 0 )
+            {
+                ++first;
+                --count;
+            }
+        }
+    }
+    size_ = 0;
+}
+
+} // namespace compilers
+} // namespace tusur
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <charconv>
+#include <concepts>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tusur
+{
+namespace compilers
+{
+
+///@brief Буферизованный вывод в файловый дескриптор
+///
+/// Все пишется в один буфер, который сбрасывается системным вызовом только при заполнении, по Flush и
+/// в деструкторе. Данные, которые не помещаются в буфер, уходят одним writev вместе с ним, без копирования.
+class OutputWriter
+{
+public:
+    static constexpr size_t DefaultCapacity = 1 << 20;
+
+    ///@param fd Дескриптор вывода, не закрывается
+    explicit OutputWriter(int fd, size_t capacity = DefaultCapacity);
+
+    ///@brief Вывод в файл, который создается или обрезается
+    explicit OutputWriter(std::string const& path, size_t capacity = DefaultCapacity);
+
+    OutputWriter(OutputWriter const&) = delete;
+    OutputWriter& operator=(OutputWriter const&) = delete;
+
+    ///@brief Сбросить буфер. Ошибки сброса здесь уже некому сообщить, поэтому они игнорируются
+    ~OutputWriter();
+
+    OutputWriter& operator<<(std::string_view text);
+    OutputWriter& operator<<(char symbol);
+
+    template<std::integral T>
+    OutputWriter& operator<<(T value);
+
+    ///@brief Записать count одинаковых символов
+    OutputWriter& Repeat(char symbol, size_t count);
+
+    ///@brief Отдать содержимое буфера системе
+    void Flush();
+
+private:
+    // Записать буфер и text одним системным вызовом и очистить буфер
+    void WriteThrough(std::string_view text);
+
+private:
+    int fd_;
+    bool ownsFd_;
+    std::vector<char> buffer_;
+    size_t size_ = 0;
+};
+
+template<std::integral T>
+OutputWriter& OutputWriter::operator<<(T value)
+{
+    char digits[24];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+    return *this << std::string_view(digits, end - digits);
+}
+
+///@brief Вывод в строку с тем же интерфейсом, что у OutputWriter
+///
+/// Для отчетов, которые нужны целиком, например для ответа сервера
+class StringOutput
+{
+public:
+    ///@param target Строка, в конец которой дописывается вывод
+    explicit StringOutput(std::string& target)
+        : target_(target)
+    {}
+
+    StringOutput& operator<<(std::string_view text)
+    {
+        target_.append(text);
+        return *this;
+    }
+
+    StringOutput& operator<<(char symbol)
+    {
+        target_.push_back(symbol);
+        return *this;
+    }
+
+    template<std::integral T>
+    StringOutput& operator<<(T value)
+    {
+        char digits[24];
+        auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+        return *this << std::string_view(digits, end - digits);
+    }
+
+    StringOutput& Repeat(char symbol, size_t count)
+    {
+        target_.append(count, symbol);
+        return *this;
+    }
+
+private:
+    std::string& target_;
+};
+
+} // namespace compilers
+} // namespace tusur
@@ -8,6 +8,7 @@
 #include <vector>
 
 #include <errors.h>
+#include <stats.h>
 
 namespace tusur
 {
@@ -42,6 +43,9 @@ class PushdownAutomaton
     {
         Transition<C, I> transition;
         bool isFinal;
+#ifdef LAB1C_STATS
+        std::uint64_t transitionsTaken = 0;
+#endif
     };
     using StateMap = std::map<std::string, State>;
     using Finalizer = std::function<void( char, std::string const&, std::stack<I>&, C& )>; // TODO: некрасиво дублируются параметры тут и в Transition
@@ -55,6 +59,17 @@ public:
 
     void SetFinalizer(Finalizer&& finalizer);
 
+    ///@brief Имена зарегистрированных состояний
+    std::vector<std::string> StateNames() const;
+
+    bool IsFinalState(std::string const& name) const;
+
+    ///@brief Вызвать функцию перехода состояния from, не меняя текущее состояние. Нужно для анализа автомата
+    TransitionResult ProbeTransition(std::string const& from, char symbol, std::stack<I>& stack, C& context);
+
+    ///@brief Вызвать финализатор так, как если бы текст закончился в состоянии state
+    void ProbeFinalizer(std::string const& state, char lastSymbol, std::stack<I>& stack, C& context);
+
     // @brief Обработать текст автоматом
     // @param textBegin Итератор начала строки входных данных // TODO: неконсистентно как-то. Перейти бы везде на ranges
     // @param textEnd Итератор конца строки входных данных
@@ -63,6 +78,11 @@ public:
     PdaResult ProcessText(std::string::const_iterator textBegin, std::string::const_iterator textEnd,
                           std::string const& startingState, C& context);
 
+#ifdef LAB1C_STATS
+    ///@brief Добавить в статистику число переходов из каждого состояния и обнулить счетчики
+    void CollectStats(Stats& stats);
+#endif
+
 private:
     // Перейти в следующее состояние
     // true, если переход произошел
@@ -91,6 +111,48 @@ void PushdownAutomaton<C, I>::SetFinalizer(Finalizer&& finalizer)
     finalizer_ = std::move( finalizer );
 }
 
+template<typename C, typename I>
+std::vector<std::string> PushdownAutomaton<C, I>::StateNames() const
+{
+    std::vector<std::string> names;
+    for( auto const& [name, state] : states_ )
+    {
+        names.push_back(name);
+    }
+    return names;
+}
+
+template<typename C, typename I>
+bool PushdownAutomaton<C, I>::IsFinalState(std::string const& name) const
+{
+    auto state = states_.find(name);
+    if( state == states_.end() )
+    {
+        throw InvalidState();
+    }
+    return state->second.isFinal;
+}
+
+template<typename C, typename I>
+TransitionResult PushdownAutomaton<C, I>::ProbeTransition(std::string const& from, char symbol, std::stack<I>& stack, C& context)
+{
+    auto state = states_.find(from);
+    if( state == states_.end() )
+    {
+        throw InvalidState();
+    }
+    return state->second.transition(symbol, stack, context);
+}
+
+template<typename C, typename I>
+void PushdownAutomaton<C, I>::ProbeFinalizer(std::string const& state, char lastSymbol, std::stack<I>& stack, C& context)
+{
+    if( finalizer_ )
+    {
+        finalizer_(lastSymbol, state, stack, context);
+    }
+}
+
 template<typename C, typename I>
 bool PushdownAutomaton<C, I>::NextState(char symbol, C& context)
 {
@@ -100,6 +162,7 @@ bool PushdownAutomaton<C, I>::NextState(char symbol, C& context)
         return false;
     }
 
+    LAB1C_STATS_DO( ++currentState_->second.transitionsTaken );
     currentState_ = states_.find( nextStateName.value() );
     if( currentState_ == states_.end() )
     {
@@ -121,6 +184,7 @@ PdaResult PushdownAutomaton<C, I>::ProcessText(std::string::const_iterator textB
     {
         throw PdaError("Invalid starting state");
     }
+    stack_ = {}; // автомат может использоваться повторно
 
     auto currentSymbol = textBegin;
     for(; currentSymbol != textEnd; ++currentSymbol)
@@ -131,12 +195,14 @@ PdaResult PushdownAutomaton<C, I>::ProcessText(std::string::const_iterator textB
         }
     }
 
+    LAB1C_STATS_DO( CurrentStats().bytesProcessed += currentSymbol - textBegin );
+
     int ret = Success;
     if( currentSymbol != textEnd )
     {
         ret |= EndOfTextNotReached;
     }
-    else
+    else if( textBegin != textEnd )
     {
         finalizer_(*(textEnd - 1), currentState_->first, stack_, context);
     }
@@ -151,5 +217,17 @@ PdaResult PushdownAutomaton<C, I>::ProcessText(std::string::const_iterator textB
     return {ret, currentSymbol};
 }
 
+#ifdef LAB1C_STATS
+template<typename C, typename I>
+void PushdownAutomaton<C, I>::CollectStats(Stats& stats)
+{
+    for( auto& [name, state] : states_ )
+    {
+        stats.transitions[name] += state.transitionsTaken;
+        state.transitionsTaken = 0;
+    }
+}
+#endif
+
 } // namespace compilers
 } // namespace tusur
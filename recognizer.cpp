@@ -0,0 +1,329 @@
+#include <recognizer.h>
+
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include <stdexcept>
+
+#include <helpers.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+namespace
+{
+
+bool IsFinal(LabOneState state)
+{
+    using enum LabOneState;
+    return state == Id || state == P || state == NumInt || state == NumFrac || state == Exp;
+}
+
+// Переход по символу. std::nullopt, если переход невозможен; тогда состояние и глубина не меняются
+std::optional<LabOneState> Step(LabOneState state, size_t& depth, char symbol)
+{
+    using enum LabOneState;
+
+    // Хвост состояний конца операнда: операция, закрывающая скобка или пробел
+    auto operandEnd = [&depth](char symbol) -> std::optional<LabOneState>
+    {
+        if( symbol == '*' || symbol == '+' )
+        {
+            return Q;
+        }
+        if( symbol == ')' && depth > 0 )
+        {
+            --depth;
+            return P;
+        }
+        if( std::isspace(symbol) )
+        {
+            return P;
+        }
+        return std::nullopt;
+    };
+
+    switch( state )
+    {
+        case Begin:
+            if( std::isspace(symbol) )
+            {
+                return Begin;
+            }
+            if( helpers::is_alpha_us(symbol) )
+            {
+                return IdLvalueRest;
+            }
+            return std::nullopt;
+
+        case IdLvalueRest:
+            if( helpers::is_alnum_us(symbol) )
+            {
+                return IdLvalueRest;
+            }
+            if( std::isspace(symbol) )
+            {
+                return LeftWhitespace;
+            }
+            if( symbol == '=' )
+            {
+                return Q;
+            }
+            return std::nullopt;
+
+        case LeftWhitespace:
+            if( std::isspace(symbol) )
+            {
+                return LeftWhitespace;
+            }
+            if( symbol == '=' )
+            {
+                return Q;
+            }
+            return std::nullopt;
+
+        case Q:
+            if( symbol == '(' )
+            {
+                ++depth;
+                return Q;
+            }
+            if( std::isspace(symbol) )
+            {
+                return Q;
+            }
+            if( helpers::is_alpha_us(symbol) )
+            {
+                return Id;
+            }
+            if( std::isdigit(symbol) )
+            {
+                return NumInt;
+            }
+            return std::nullopt;
+
+        case Id:
+            if( helpers::is_alnum_us(symbol) )
+            {
+                return Id;
+            }
+            return operandEnd(symbol);
+
+        case P:
+            if( std::isspace(symbol) )
+            {
+                return P;
+            }
+            return operandEnd(symbol);
+
+        case NumInt:
+            if( std::isdigit(symbol) )
+            {
+                return NumInt;
+            }
+            if( symbol == '.' )
+            {
+                return Dot;
+            }
+            if( symbol == 'e' || symbol == 'E' )
+            {
+                return ExpLetter;
+            }
+            return operandEnd(symbol);
+
+        case Dot:
+            if( std::isdigit(symbol) )
+            {
+                return NumFrac;
+            }
+            return std::nullopt;
+
+        case NumFrac:
+            if( std::isdigit(symbol) )
+            {
+                return NumFrac;
+            }
+            if( symbol == 'e' || symbol == 'E' )
+            {
+                return ExpLetter;
+            }
+            return operandEnd(symbol);
+
+        case ExpLetter:
+            if( std::isdigit(symbol) )
+            {
+                return Exp;
+            }
+            if( symbol == '+' || symbol == '-' )
+            {
+                return ExpSign;
+            }
+            return std::nullopt;
+
+        case ExpSign:
+            if( std::isdigit(symbol) )
+            {
+                return Exp;
+            }
+            return std::nullopt;
+
+        case Exp:
+            if( std::isdigit(symbol) )
+            {
+                return Exp;
+            }
+            return operandEnd(symbol);
+    }
+    return std::nullopt;
+}
+
+// Флаги так же, как в PushdownAutomaton::ProcessText, для автомата, остановившегося на offset
+RecognitionResult Finish(LabOneState state, size_t depth, size_t offset, size_t size)
+{
+    int flags = Success;
+    if( offset != size )
+    {
+        flags |= EndOfTextNotReached;
+    }
+    if( !IsFinal(state) )
+    {
+        flags |= StateIsNotFinal;
+    }
+    if( depth != 0 )
+    {
+        flags |= StackIsNotEmpty;
+    }
+    return { flags, offset };
+}
+
+} // namespace anonymous
+
+RecognitionResult RecognizeLabOne(std::string_view input)
+{
+    auto state = LabOneState::Begin;
+    size_t depth = 0;
+    size_t offset = 0;
+    for(; offset < input.size(); ++offset )
+    {
+        auto next = Step(state, depth, input[offset]);
+        if( !next )
+        {
+            break;
+        }
+        state = *next;
+    }
+    return Finish(state, depth, offset, input.size());
+}
+
+IncrementalRecognizer::IncrementalRecognizer(size_t checkpointInterval)
+    : checkpointInterval_(std::max<size_t>(checkpointInterval, 1))
+{
+}
+
+RecognitionResult IncrementalRecognizer::Reset(std::string text)
+{
+    text_ = std::move(text);
+    checkpoints_.assign(1, { 0, LabOneState::Begin, 0 });
+    Run({}, 0, {});
+    return result_;
+}
+
+RecognitionResult IncrementalRecognizer::Edit(size_t offset, size_t removed, std::string_view inserted)
+{
+    if( offset > text_.size() || removed > text_.size() - offset )
+    {
+        throw std::out_of_range("Edit is out of text");
+    }
+    if( checkpoints_.empty() )
+    {
+        checkpoints_.assign(1, { 0, LabOneState::Begin, 0 });
+    }
+    text_.replace(offset, removed, inserted);
+
+    // Автомат остановился до правки, значит, остановится там же и сейчас
+    if( result_.errorOffset < offset )
+    {
+        bytesScanned_ = 0;
+        return result_;
+    }
+
+    auto byPosition = [](Checkpoint const& checkpoint, size_t position){ return checkpoint.position < position; };
+    // Последняя точка не дальше правки: текст перед ней не изменился. Первая точка в начале текста есть всегда
+    auto resume = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), offset,
+                                   [](size_t position, Checkpoint const& checkpoint){ return position < checkpoint.position; }) - 1;
+    // Точки не ближе конца правки: текст после них тоже не изменился
+    auto tail = std::lower_bound(resume + 1, checkpoints_.end(), offset + removed, byPosition);
+
+    std::vector<Checkpoint> oldTail(tail, checkpoints_.end());
+    checkpoints_.erase(resume + 1, checkpoints_.end());
+    Run(oldTail, static_cast<std::ptrdiff_t>(inserted.size()) - static_cast<std::ptrdiff_t>(removed), result_);
+    return result_;
+}
+
+void IncrementalRecognizer::Run(std::vector<Checkpoint> const& oldTail, std::ptrdiff_t shift, RecognitionResult oldResult)
+{
+    auto shifted = [shift](size_t position){ return static_cast<size_t>(static_cast<std::ptrdiff_t>(position) + shift); };
+
+    const size_t start = checkpoints_.back().position;
+    auto state = checkpoints_.back().state;
+    size_t depth = checkpoints_.back().depth;
+    size_t lastCheckpoint = start;
+    auto nextOld = oldTail.begin();
+
+    size_t position = start;
+    for(; position < text_.size(); ++position )
+    {
+        while( nextOld != oldTail.end() && shifted(nextOld->position) < position )
+        {
+            ++nextOld;
+        }
+        if( nextOld != oldTail.end() && shifted(nextOld->position) == position
+            && nextOld->state == state && nextOld->depth == depth )
+        {
+            // Дальше разбор повторил бы предыдущий
+            for(; nextOld != oldTail.end(); ++nextOld )
+            {
+                checkpoints_.push_back({ shifted(nextOld->position), nextOld->state, nextOld->depth });
+            }
+            bytesScanned_ = position - start;
+            result_ = { oldResult.flags, shifted(oldResult.errorOffset) };
+            return;
+        }
+
+        if( position - lastCheckpoint >= checkpointInterval_ )
+        {
+            checkpoints_.push_back({ position, state, depth });
+            lastCheckpoint = position;
+        }
+
+        auto next = Step(state, depth, text_[position]);
+        if( !next )
+        {
+            break;
+        }
+        state = *next;
+    }
+
+    bytesScanned_ = position - start;
+    result_ = Finish(state, depth, position, text_.size());
+}
+
+std::string const& IncrementalRecognizer::Text() const
+{
+    return text_;
+}
+
+RecognitionResult IncrementalRecognizer::Result() const
+{
+    return result_;
+}
+
+size_t IncrementalRecognizer::BytesScanned() const
+{
+    return bytesScanned_;
+}
+
+} // namespace compilers
+} // namespace tusur
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <pda.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+///@brief Состояния автомата первой лабораторной, см. state_names
+enum class LabOneState : std::uint8_t
+{
+    Begin,
+    IdLvalueRest,
+    LeftWhitespace,
+    Q,
+    Id,
+    P,
+    NumInt,
+    Dot,
+    NumFrac,
+    ExpLetter,
+    ExpSign,
+    Exp,
+};
+
+///@brief Результат распознавания
+struct RecognitionResult
+{
+    int flags;          // PdaFlags
+    size_t errorOffset; // позиция символа, на котором автомат остановился, либо длина входа
+};
+
+///@brief Проверить выражение автоматом первой лабораторной без построения лексем и генерации кода
+///
+/// Переходы те же, что в RegisterLabOneStates, и результат совпадает с PushdownAutomaton::ProcessText,
+/// но состояния перебираются switch'ем, а стек скобок заменен счетчиком глубины.
+RecognitionResult RecognizeLabOne(std::string_view input);
+
+///@brief Распознаватель для повторных проверок редактируемого выражения
+///
+/// Примерно через каждые checkpointInterval байт запоминает состояние автомата и глубину скобок.
+/// После правки разбор продолжается с последней контрольной точки перед ней и заканчивается, как только
+/// в одной из старых точек за правкой состояние совпадет с прежним: дальше разбор повторил бы предыдущий.
+/// Так время проверки зависит от размера правки, а не от длины выражения.
+class IncrementalRecognizer
+{
+public:
+    explicit IncrementalRecognizer(size_t checkpointInterval = 256);
+
+    ///@brief Проверить новое выражение целиком
+    RecognitionResult Reset(std::string text);
+
+    ///@brief Заменить removed байт, начиная с offset, на inserted и проверить выражение заново
+    RecognitionResult Edit(size_t offset, size_t removed, std::string_view inserted);
+
+    std::string const& Text() const;
+    RecognitionResult Result() const;
+
+    ///@brief Сколько байт пришлось разобрать при последней проверке
+    size_t BytesScanned() const;
+
+private:
+    struct Checkpoint
+    {
+        size_t position; // состояние перед символом с этим смещением
+        LabOneState state;
+        size_t depth;
+    };
+
+    // Продолжить разбор с последней контрольной точки. Если в одной из точек oldTail, сдвинутых на shift,
+    // состояние совпадет, результат берется из oldResult
+    void Run(std::vector<Checkpoint> const& oldTail, std::ptrdiff_t shift, RecognitionResult oldResult);
+
+private:
+    size_t checkpointInterval_;
+    std::string text_;
+    std::vector<Checkpoint> checkpoints_; // по возрастанию позиции, первая всегда в начале текста
+    RecognitionResult result_{};
+    size_t bytesScanned_ = 0;
+};
+
+} // namespace compilers
+} // namespace tusur
@@ -0,0 +1,340 @@
+#include <register_machine.h>
+
+#include <algorithm>
+#include <bitset>
+#include <set>
+
+#include <errors.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+namespace
+{
+
+constexpr int Spilled = -1;
+
+struct LiveInterval
+{
+    size_t start; // инструкция, присваивающая регистр
+    size_t end;   // последняя инструкция, читающая регистр
+};
+
+bool IsOperand(ExpressionTree::Node const& node)
+{
+    return node.lhs == ExpressionTree::NoNode;
+}
+
+// Обойти узлы дерева так, чтобы каждый узел посещался после своих операндов
+template<typename Visitor>
+void VisitPostOrder(ExpressionTree const& tree, Visitor visit)
+{
+    std::vector<std::pair<size_t, bool>> stack{ { tree.Root(), false } }; // узел и признак того, что операнды уже обработаны
+    while( !stack.empty() )
+    {
+        auto [index, operandsDone] = stack.back();
+        stack.pop_back();
+
+        auto const& node = tree.GetNode(index);
+        if( IsOperand(node) || operandsDone )
+        {
+            visit(index, node);
+            continue;
+        }
+        stack.emplace_back(index, true);
+        stack.emplace_back(node.rhs, false);
+        stack.emplace_back(node.lhs, false);
+    }
+}
+
+RegisterInstruction::Opcode OperationOpcode(LexemeType type)
+{
+    switch( type )
+    {
+        case PlusSign:
+            return RegisterInstruction::Add;
+        case MultipliesSign:
+            return RegisterInstruction::Mpy;
+        default:
+            throw CompilationError("Unknown operation: " + LexemeTypeToString(type));
+    }
+}
+
+std::vector<LiveInterval> ComputeLiveIntervals(std::vector<RegisterInstruction> const& code)
+{
+    std::vector<LiveInterval> intervals;
+    for( size_t i = 0; i < code.size(); ++i )
+    {
+        for( int reg : { code[i].lhs, code[i].rhs } )
+        {
+            if( reg >= 0 )
+            {
+                intervals[reg].end = i;
+            }
+        }
+        if( code[i].dst >= 0 )
+        {
+            if( code[i].dst != static_cast<int>(intervals.size()) )
+            {
+                throw CompilationError("Virtual registers have to be assigned once and in order");
+            }
+            intervals.push_back({ i, i });
+        }
+    }
+    return intervals;
+}
+
+// Физический регистр для каждого интервала либо Spilled. Интервалы упорядочены по началу
+std::vector<int> LinearScan(std::vector<LiveInterval> const& intervals, int registerCount)
+{
+    std::vector<int> assigned(intervals.size(), Spilled);
+    std::vector<size_t> active; // занимающие регистры интервалы по возрастанию конца
+    std::bitset<MAX_REGISTER_COUNT> busy;
+
+    auto activate = [&](size_t interval)
+    {
+        auto position = std::upper_bound(active.begin(), active.end(), interval,
+            [&intervals](size_t lhs, size_t rhs){ return intervals[lhs].end < intervals[rhs].end; });
+        active.insert(position, interval);
+    };
+
+    for( size_t i = 0; i < intervals.size(); ++i )
+    {
+        // Регистр, прочитанный последний раз этой же инструкцией, можно сразу занять под результат
+        while( !active.empty() && intervals[active.front()].end <= intervals[i].start )
+        {
+            busy.reset(assigned[active.front()]);
+            active.erase(active.begin());
+        }
+
+        if( static_cast<int>(active.size()) < registerCount )
+        {
+            int reg = 0;
+            while( busy.test(reg) )
+            {
+                ++reg;
+            }
+            busy.set(reg);
+            assigned[i] = reg;
+            activate(i);
+            continue;
+        }
+
+        // Регистров нет: сбрасывается тот из интервалов, что закончится позже
+        const size_t last = active.back();
+        if( intervals[last].end > intervals[i].end )
+        {
+            assigned[i] = assigned[last];
+            assigned[last] = Spilled;
+            active.pop_back();
+            activate(i);
+        }
+    }
+    return assigned;
+}
+
+std::string RegisterName(int reg)
+{
+    return "r" + std::to_string(reg);
+}
+
+} // namespace anonymous
+
+size_t RegisterProgram::MemoryOperations() const
+{
+    return std::count_if(code.begin(), code.end(), [](auto const& instruction)
+        {
+            return instruction.opcode == RegisterInstruction::Load || instruction.opcode == RegisterInstruction::Store;
+        });
+}
+
+std::string RegisterProgram::ToString() const
+{
+    std::string text;
+    for( auto const& instruction : code )
+    {
+        if( !text.empty() )
+        {
+            text += "\n";
+        }
+        switch( instruction.opcode )
+        {
+            case RegisterInstruction::Load:
+                text += "LOAD " + RegisterName(instruction.dst) + ", " + instruction.memory;
+                break;
+            case RegisterInstruction::Store:
+                text += "STORE " + instruction.memory + ", " + RegisterName(instruction.lhs);
+                break;
+            case RegisterInstruction::Add:
+            case RegisterInstruction::Mpy:
+                text += (instruction.opcode == RegisterInstruction::Add ? "ADD " : "MPY ")
+                      + RegisterName(instruction.dst) + ", "
+                      + RegisterName(instruction.lhs) + ", "
+                      + RegisterName(instruction.rhs);
+                break;
+        }
+    }
+    return text;
+}
+
+std::vector<RegisterInstruction> LowerToRegisterCode(ExpressionTree const& tree, std::string const& target)
+{
+    // Сколько регистров нужно поддереву, если сначала вычислять более требовательный операнд
+    std::vector<int> need(tree.Size(), 1);
+    VisitPostOrder(tree, [&need](size_t index, auto const& node)
+        {
+            if( !IsOperand(node) )
+            {
+                need[index] = need[node.lhs] == need[node.rhs] ? need[node.lhs] + 1 : std::max(need[node.lhs], need[node.rhs]);
+            }
+        });
+
+    std::vector<RegisterInstruction> code;
+    std::vector<int> value(tree.Size(), -1); // виртуальный регистр с результатом узла
+    int nextRegister = 0;
+
+    std::vector<std::pair<size_t, bool>> stack{ { tree.Root(), false } };
+    while( !stack.empty() )
+    {
+        auto [index, operandsDone] = stack.back();
+        stack.pop_back();
+
+        auto const& node = tree.GetNode(index);
+        if( IsOperand(node) )
+        {
+            code.push_back({ RegisterInstruction::Load, nextRegister, -1, -1, node.text });
+            value[index] = nextRegister++;
+        }
+        else if( operandsDone )
+        {
+            code.push_back({ OperationOpcode(node.type), nextRegister, value[node.lhs], value[node.rhs], {} });
+            value[index] = nextRegister++;
+        }
+        else
+        {
+            const bool rhsFirst = need[node.rhs] > need[node.lhs];
+            stack.emplace_back(index, true);
+            stack.emplace_back(rhsFirst ? node.lhs : node.rhs, false);
+            stack.emplace_back(rhsFirst ? node.rhs : node.lhs, false);
+        }
+    }
+
+    code.push_back({ RegisterInstruction::Store, -1, value[tree.Root()], -1, target });
+    return code;
+}
+
+RegisterProgram AllocateRegisters(std::vector<RegisterInstruction> const& code, int registerCount)
+{
+    if( registerCount < 1 || registerCount > MAX_REGISTER_COUNT )
+    {
+        throw CompilationError("Register count has to be between 1 and " + std::to_string(MAX_REGISTER_COUNT));
+    }
+
+    const auto intervals = ComputeLiveIntervals(code);
+    auto assigned = LinearScan(intervals, registerCount);
+
+    RegisterProgram program;
+    program.spilledRegisters = std::count(assigned.begin(), assigned.end(), Spilled);
+    int scratch[2] = {};
+    if( program.spilledRegisters > 0 )
+    {
+        // Операндам и результату сброшенных регистров нужны свои регистры на время инструкции
+        if( registerCount < 3 )
+        {
+            throw CompilationError("Not enough registers for spill code");
+        }
+        scratch[0] = registerCount - 2;
+        scratch[1] = registerCount - 1;
+        assigned = LinearScan(intervals, registerCount - 2);
+        program.spilledRegisters = std::count(assigned.begin(), assigned.end(), Spilled);
+    }
+
+    std::vector<std::string> spillLocation(intervals.size()); // откуда перечитывать сброшенный регистр
+    std::set<int> freeSlots;
+    int nextSlot = 0;
+
+    for( size_t i = 0; i < code.size(); ++i )
+    {
+        auto instruction = code[i];
+        int nextScratch = 0;
+
+        auto use = [&](int vreg)
+        {
+            if( assigned[vreg] != Spilled )
+            {
+                return assigned[vreg];
+            }
+            const int reg = scratch[nextScratch++];
+            program.code.push_back({ RegisterInstruction::Load, reg, -1, -1, spillLocation[vreg] });
+            if( spillLocation[vreg].starts_with("$") && intervals[vreg].end == i )
+            {
+                freeSlots.insert(std::stoi(spillLocation[vreg].substr(1)));
+            }
+            return reg;
+        };
+
+        if( instruction.lhs >= 0 )
+        {
+            instruction.lhs = use(instruction.lhs);
+        }
+        if( instruction.rhs >= 0 )
+        {
+            instruction.rhs = use(instruction.rhs);
+        }
+
+        if( instruction.dst < 0 )
+        {
+            program.code.push_back(std::move(instruction));
+            continue;
+        }
+
+        const int vreg = instruction.dst;
+        if( assigned[vreg] != Spilled )
+        {
+            instruction.dst = assigned[vreg];
+            program.code.push_back(std::move(instruction));
+        }
+        else if( instruction.opcode == RegisterInstruction::Load )
+        {
+            // Значение и так лежит в памяти, загрузим его там, где оно понадобится
+            spillLocation[vreg] = instruction.memory;
+        }
+        else
+        {
+            int slot = nextSlot;
+            if( freeSlots.empty() )
+            {
+                ++nextSlot;
+            }
+            else
+            {
+                slot = *freeSlots.begin();
+                freeSlots.erase(freeSlots.begin());
+            }
+            spillLocation[vreg] = "$" + std::to_string(slot);
+            instruction.dst = scratch[0];
+            program.code.push_back(std::move(instruction));
+            program.code.push_back({ RegisterInstruction::Store, -1, scratch[0], -1, spillLocation[vreg] });
+        }
+    }
+    return program;
+}
+
+size_t AccumulatorInstructionCount(ExpressionTree const& tree)
+{
+    // Операнд - одна загрузка, операция добавляет к операндам STORE $n и ADD/MPY $n
+    std::vector<size_t> count(tree.Size(), 1);
+    VisitPostOrder(tree, [&count](size_t index, auto const& node)
+        {
+            if( !IsOperand(node) )
+            {
+                count[index] = count[node.lhs] + count[node.rhs] + 2;
+            }
+        });
+    return count[tree.Root()] + 1; // STORE результата
+}
+
+} // namespace compilers
+} // namespace tusur
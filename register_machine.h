@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <compilation.h>
+#include <expression.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+///@brief Инструкция трехадресной регистровой машины
+///
+/// LOAD dst, memory
+/// STORE memory, lhs
+/// ADD dst, lhs, rhs
+/// MPY dst, lhs, rhs
+struct RegisterInstruction
+{
+    enum Opcode
+    {
+        Load,
+        Store,
+        Add,
+        Mpy,
+    };
+
+    Opcode opcode;
+    int dst = -1;
+    int lhs = -1;
+    int rhs = -1;
+    std::string memory; // имя переменной, литерал или ячейка сброса $n
+};
+
+///@brief Программа для регистровой машины после распределения регистров
+struct RegisterProgram
+{
+    std::vector<RegisterInstruction> code;
+    size_t spilledRegisters = 0; // сколько виртуальных регистров не поместилось в физические
+
+    ///@brief Число инструкций LOAD и STORE
+    size_t MemoryOperations() const;
+
+    std::string ToString() const;
+};
+
+///@brief Перевести присваивание target = tree в трехадресный код на неограниченном числе виртуальных регистров
+///
+/// Каждый виртуальный регистр присваивается ровно один раз. Из двух операндов первым вычисляется тот,
+/// которому нужно больше регистров (порядок Сети-Ульмана), так что регистров нужно не больше log2 от числа операндов.
+std::vector<RegisterInstruction> LowerToRegisterCode(ExpressionTree const& tree, std::string const& target);
+
+///@brief Распределить регистры линейным сканированием интервалов жизни
+///
+/// Если регистров не хватает, сбрасывается интервал, который живет дольше всех. Сброшенный регистр,
+/// загруженный из переменной или литерала, заново загружается из неё при каждом использовании, остальные
+/// сохраняются в ячейки $n. Тогда два последних регистра отводятся под временные значения сброшенных.
+///@param code Результат LowerToRegisterCode
+///@param registerCount Число физических регистров, не больше MAX_REGISTER_COUNT
+RegisterProgram AllocateRegisters(std::vector<RegisterInstruction> const& code, int registerCount = MAX_REGISTER_COUNT);
+
+///@brief Число инструкций, которое сгенерирует для присваивания аккумуляторная машина (Compilation::Combine)
+size_t AccumulatorInstructionCount(ExpressionTree const& tree);
+
+} // namespace compilers
+} // namespace tusur
@@ -0,0 +1,33 @@
+#include <report.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+std::string PdaFlagsToString(int flags)
+{
+    if( flags == PdaFlags::Success )
+    {
+        return "Success";
+    }
+
+    std::string ret;
+    if( flags & PdaFlags::StateIsNotFinal )
+    {
+        ret += "StateIsNotFinal ";
+    }
+    if( flags & PdaFlags::EndOfTextNotReached )
+    {
+        ret += "EndOfTextNotReached ";
+    }
+    if( flags & PdaFlags::StackIsNotEmpty )
+    {
+        ret += "StackIsNotEmpty ";
+    }
+
+    return ret;
+}
+
+} // namespace compilers
+} // namespace tusur
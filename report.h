@@ -0,0 +1,81 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <compilation.h>
+#include <pda.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+std::string PdaFlagsToString(int flags);
+
+///@brief Вывести результат разбора: "Correct" либо указатель на место ошибки
+///@tparam Out OutputWriter или StringOutput
+///@param input Разобранное выражение
+///@param res Результат работы автомата над input
+///@param error Сообщение об ошибке
+///@param inputIsAtTerminal Если false, выражение выводится перед результатом
+template<typename Out>
+void WritePdaResult(Out& out, std::string const& input, PdaResult res, std::optional<std::string> const& error,
+                    bool inputIsAtTerminal);
+
+///@brief Вывести таблицу символов, которой заканчивается WriteCompilationResult
+template<typename Out>
+void WriteSymbolTable(Out& out, std::unordered_map<std::string, LexemeType> const& symbolTable);
+
+///@brief Вывести код и таблицу символов
+template<typename Out>
+void WriteCompilationResult(Out& out, std::string_view code, std::unordered_map<std::string, LexemeType> const& symbolTable);
+
+
+// Имплементация
+
+template<typename Out>
+void WritePdaResult(Out& out, std::string const& input, PdaResult res, std::optional<std::string> const& error,
+                    bool inputIsAtTerminal)
+{
+    if( !inputIsAtTerminal )
+    {
+        out << input << '\n';
+    }
+
+    auto [flags, iter] = res;
+    if( flags == PdaFlags::Success )
+    {
+        out << "Correct";
+        return;
+    }
+
+    out.Repeat(' ', iter - input.begin()) << '^';
+    if( error )
+    {
+        out << ' ' << *error;
+    }
+    out << " PDA flags: " << PdaFlagsToString(flags);
+}
+
+template<typename Out>
+void WriteSymbolTable(Out& out, std::unordered_map<std::string, LexemeType> const& symbolTable)
+{
+    out << "\nSymbol table:\n";
+    for( auto const& [name, type] : symbolTable )
+    {
+        out << '\t' << LexemeTypeToString(type) << ' ' << name << '\n';
+    }
+}
+
+template<typename Out>
+void WriteCompilationResult(Out& out, std::string_view code, std::unordered_map<std::string, LexemeType> const& symbolTable)
+{
+    out << "\nCode:\n" << code << '\n';
+    WriteSymbolTable(out, symbolTable);
+}
+
+} // namespace compilers
+} // namespace tusur
@@ -0,0 +1,661 @@
+#include <server.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <lab_one.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t MaxRequestSize = 16 * 1024 * 1024;
+constexpr size_t HeaderSize = sizeof(uint32_t);
+
+// Идентификаторы в epoll_event::data. Соединения нумеруются после служебных
+constexpr uint64_t ListenerId = 0;
+constexpr uint64_t SignalId   = 1;
+constexpr uint64_t WakeUpId   = 2;
+
+[[noreturn]] void ThrowSystemError(char const* what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Дескриптор, закрываемый в деструкторе
+class FileDescriptor
+{
+public:
+    explicit FileDescriptor(int fd = -1) : fd_(fd) {}
+    FileDescriptor(FileDescriptor&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+    FileDescriptor& operator=(FileDescriptor&& other) noexcept
+    {
+        std::swap(fd_, other.fd_);
+        return *this;
+    }
+    ~FileDescriptor()
+    {
+        if( fd_ >= 0 )
+        {
+            ::close(fd_);
+        }
+    }
+
+    int Get() const { return fd_; }
+
+private:
+    int fd_;
+};
+
+struct Job
+{
+    uint64_t connectionId;
+    std::string statement;
+    Clock::time_point received;
+};
+
+struct Completion
+{
+    uint64_t connectionId;
+    std::string response;
+    Clock::time_point received;
+};
+
+struct Connection
+{
+    FileDescriptor fd;
+    std::string input;
+    std::string output;
+    bool busy = false;       // запрос в работе, следующий не отдаем, чтобы не перепутать порядок ответов
+    bool peerClosed = false;
+    uint32_t events = EPOLLIN; // на что дескриптор подписан в epoll, 0 - удален из epoll
+};
+
+// Длина запроса из заголовка в начале input
+uint32_t AnnouncedSize(std::string const& input)
+{
+    uint32_t size;
+    std::memcpy(&size, input.data(), HeaderSize);
+    return ntohl(size);
+}
+
+// Во входном буфере уже лежит целый запрос. Пока он не отдан в работу, дальше не читаем,
+// иначе клиент, шлющий запросы без остановки, раздул бы буфер
+bool HasFullRequest(Connection const& connection)
+{
+    return connection.input.size() >= HeaderSize
+        && connection.input.size() >= HeaderSize + AnnouncedSize(connection.input);
+}
+
+// Гистограмма задержек в микросекундах: 32 корзины на каждую степень двойки, погрешность до 3%
+class LatencyHistogram
+{
+public:
+    void Add(std::chrono::microseconds latency)
+    {
+        const auto value = static_cast<uint64_t>(std::max<int64_t>(0, latency.count()));
+        ++counts_[Bucket(value)];
+        ++count_;
+        max_ = std::max(max_, value);
+    }
+
+    size_t Count() const
+    {
+        return count_;
+    }
+
+    uint64_t Max() const
+    {
+        return max_;
+    }
+
+    // Верхняя граница корзины, в которую попадает перцентиль p
+    uint64_t Percentile(double p) const
+    {
+        const size_t rank = std::min(count_ - 1, static_cast<size_t>(p * count_));
+        size_t seen = 0;
+        for( size_t bucket = 0; bucket < counts_.size(); ++bucket )
+        {
+            seen += counts_[bucket];
+            if( seen > rank )
+            {
+                return std::min(max_, UpperBound(bucket));
+            }
+        }
+        return max_;
+    }
+
+private:
+    static constexpr int SubBucketBits = 5;
+    static constexpr uint64_t SubBuckets = 1 << SubBucketBits;
+
+    static size_t Bucket(uint64_t value)
+    {
+        if( value < SubBuckets )
+        {
+            return value;
+        }
+        const int shift = std::bit_width(value) - 1 - SubBucketBits;
+        return (shift + 1) * SubBuckets + ((value >> shift) - SubBuckets);
+    }
+
+    static uint64_t UpperBound(size_t bucket)
+    {
+        if( bucket < SubBuckets )
+        {
+            return bucket;
+        }
+        const int shift = bucket / SubBuckets - 1;
+        const uint64_t lower = (SubBuckets + bucket % SubBuckets) << shift;
+        return lower + (uint64_t{ 1 } << shift) - 1;
+    }
+
+private:
+    std::array<size_t, (64 - SubBucketBits) * SubBuckets> counts_{};
+    size_t count_ = 0;
+    uint64_t max_ = 0;
+};
+
+// Очередь заданий для пула компиляторов
+class JobQueue
+{
+public:
+    void Push(Job&& job)
+    {
+        {
+            std::lock_guard lock(mutex_);
+            jobs_.push_back(std::move(job));
+        }
+        cv_.notify_one();
+    }
+
+    // std::nullopt после Close, когда задания кончились
+    std::optional<Job> Pop()
+    {
+        std::unique_lock lock(mutex_);
+        cv_.wait(lock, [this]{ return closed_ || !jobs_.empty(); });
+        if( jobs_.empty() )
+        {
+            return std::nullopt;
+        }
+        auto job = std::move(jobs_.front());
+        jobs_.pop_front();
+        return job;
+    }
+
+    void Close()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            closed_ = true;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Job> jobs_;
+    bool closed_ = false;
+};
+
+class Server
+{
+public:
+    explicit Server(ServerOptions const& options);
+    ~Server();
+
+    void Run();
+
+private:
+    void Worker();
+
+    void Accept();
+    void Read(uint64_t id, Connection& connection);
+    void Flush(uint64_t id, Connection& connection);
+    void Dispatch(uint64_t id, Connection& connection);
+    void CollectCompletions();
+    void BeginShutdown();
+
+    // Закрыть соединение, если с ним больше нечего делать
+    bool CloseIfDone(uint64_t id, Connection& connection);
+    void UpdateEvents(uint64_t id, Connection& connection);
+
+    void PrintLatencies() const;
+
+private:
+    std::string socketPath_;
+    CompileOptions compileOptions_;
+    FileDescriptor epoll_;
+    FileDescriptor listener_;
+    FileDescriptor signals_;
+    FileDescriptor wakeUp_;
+
+    JobQueue jobs_;
+    std::mutex completionsMutex_;
+    std::vector<Completion> completions_;
+    std::vector<std::thread> workers_;
+
+    std::unordered_map<uint64_t, Connection> connections_;
+    uint64_t nextConnectionId_ = WakeUpId + 1;
+    size_t inFlight_ = 0;
+    bool shuttingDown_ = false;
+
+    LatencyHistogram latencies_;
+};
+
+void AddToEpoll(int epoll, int fd, uint64_t id, uint32_t events)
+{
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = id;
+    if( ::epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) < 0 )
+    {
+        ThrowSystemError("epoll_ctl");
+    }
+}
+
+Server::Server(ServerOptions const& options)
+    : socketPath_(options.socketPath)
+    , compileOptions_(options.compileOptions)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if( socketPath_.size() >= sizeof(address.sun_path) )
+    {
+        throw std::runtime_error("Socket path is too long: " + socketPath_);
+    }
+    std::memcpy(address.sun_path, socketPath_.c_str(), socketPath_.size() + 1);
+
+    // Сокет, оставшийся от предыдущего запуска, мешает bind. Удаляем только сокеты
+    struct stat info;
+    if( ::stat(socketPath_.c_str(), &info) == 0 && S_ISSOCK(info.st_mode) )
+    {
+        ::unlink(socketPath_.c_str());
+    }
+
+    listener_ = FileDescriptor(::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+    if( listener_.Get() < 0 )
+    {
+        ThrowSystemError("socket");
+    }
+    if( ::bind(listener_.Get(), reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 )
+    {
+        ThrowSystemError("bind");
+    }
+    if( ::listen(listener_.Get(), SOMAXCONN) < 0 )
+    {
+        ThrowSystemError("listen");
+    }
+
+    // Сигналы принимаются только через signalfd, поэтому блокируются до запуска потоков
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    ::pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+    signals_ = FileDescriptor(::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC));
+    wakeUp_ = FileDescriptor(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    epoll_ = FileDescriptor(::epoll_create1(EPOLL_CLOEXEC));
+    if( signals_.Get() < 0 || wakeUp_.Get() < 0 || epoll_.Get() < 0 )
+    {
+        ThrowSystemError("server setup");
+    }
+
+    AddToEpoll(epoll_.Get(), listener_.Get(), ListenerId, EPOLLIN);
+    AddToEpoll(epoll_.Get(), signals_.Get(), SignalId, EPOLLIN);
+    AddToEpoll(epoll_.Get(), wakeUp_.Get(), WakeUpId, EPOLLIN);
+
+    unsigned workerCount = options.workerCount;
+    if( workerCount == 0 )
+    {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for( unsigned i = 0; i < workerCount; ++i )
+    {
+        workers_.emplace_back(&Server::Worker, this);
+    }
+}
+
+Server::~Server()
+{
+    jobs_.Close();
+    for( auto& worker : workers_ )
+    {
+        worker.join();
+    }
+    ::unlink(socketPath_.c_str());
+}
+
+void Server::Worker()
+{
+    // У каждого потока свой прогретый автомат: состояния регистрируются один раз
+    LabOneAutomaton pda;
+    RegisterLabOneStates(pda);
+
+    while( auto job = jobs_.Pop() )
+    {
+        std::string report;
+        try
+        {
+            StringOutput out(report);
+            CompileStatement(pda, job->statement, false, out, compileOptions_);
+        }
+        catch(std::exception& e) // в том числе std::bad_alloc: исключение из потока уронило бы весь сервер
+        {
+            report = std::string("Error: ") + e.what() + "\n";
+        }
+
+        {
+            std::lock_guard lock(completionsMutex_);
+            completions_.push_back({ job->connectionId, std::move(report), job->received });
+        }
+        const uint64_t one = 1;
+        [[maybe_unused]] auto written = ::write(wakeUp_.Get(), &one, sizeof(one));
+    }
+}
+
+void Server::Run()
+{
+    std::cerr << "lab1c: serving on " << socketPath_ << " with " << workers_.size() << " worker(s)" << std::endl;
+
+    std::vector<epoll_event> events(64);
+    while( !shuttingDown_ || inFlight_ > 0 )
+    {
+        const int count = ::epoll_wait(epoll_.Get(), events.data(), events.size(), -1);
+        if( count < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            ThrowSystemError("epoll_wait");
+        }
+
+        for( int i = 0; i < count; ++i )
+        {
+            const uint64_t id = events[i].data.u64;
+            if( id == ListenerId )
+            {
+                Accept();
+            }
+            else if( id == SignalId )
+            {
+                BeginShutdown();
+            }
+            else if( id == WakeUpId )
+            {
+                CollectCompletions();
+            }
+            else if( auto found = connections_.find(id); found != connections_.end() )
+            {
+                auto& connection = found->second;
+                if( events[i].events & EPOLLOUT )
+                {
+                    Flush(id, connection);
+                    if( CloseIfDone(id, connection) )
+                    {
+                        continue;
+                    }
+                }
+                if( events[i].events & (EPOLLHUP | EPOLLERR) )
+                {
+                    // Клиент закрыл сокет целиком: ответы ему уже не доставить, а непрочитанный
+                    // запрос EPOLLHUP сообщал бы в каждом epoll_wait
+                    connection.peerClosed = true;
+                }
+                if( events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR) )
+                {
+                    Read(id, connection);
+                }
+            }
+        }
+    }
+
+    // Досылаем ответы на уже обработанные запросы, но не ждем медленных клиентов дольше секунды
+    for( auto& [id, connection] : connections_ )
+    {
+        const timeval timeout{ 1, 0 };
+        ::setsockopt(connection.fd.Get(), SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        ::fcntl(connection.fd.Get(), F_SETFL, 0);
+        Flush(id, connection);
+    }
+    connections_.clear();
+
+    PrintLatencies();
+}
+
+void Server::Accept()
+{
+    while( true )
+    {
+        FileDescriptor fd(::accept4(listener_.Get(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC));
+        if( fd.Get() < 0 )
+        {
+            if( errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR )
+            {
+                std::cerr << "lab1c: accept: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+        const uint64_t id = nextConnectionId_++;
+        AddToEpoll(epoll_.Get(), fd.Get(), id, EPOLLIN);
+        connections_.emplace(id, Connection{ std::move(fd), {}, {} });
+    }
+}
+
+void Server::Read(uint64_t id, Connection& connection)
+{
+    char buffer[4096];
+    while( !connection.peerClosed && !HasFullRequest(connection) )
+    {
+        const ssize_t size = ::read(connection.fd.Get(), buffer, sizeof(buffer));
+        if( size > 0 )
+        {
+            connection.input.append(buffer, size);
+            if( connection.input.size() >= HeaderSize && AnnouncedSize(connection.input) > MaxRequestSize )
+            {
+                std::cerr << "lab1c: request of " << AnnouncedSize(connection.input)
+                          << " bytes is too large, closing connection" << std::endl;
+                connection.input.clear();
+                connection.peerClosed = true;
+            }
+            continue;
+        }
+        if( size < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if( size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK) )
+        {
+            connection.peerClosed = true;
+        }
+        break;
+    }
+
+    Dispatch(id, connection);
+    if( !CloseIfDone(id, connection) )
+    {
+        UpdateEvents(id, connection);
+    }
+}
+
+void Server::Dispatch(uint64_t id, Connection& connection)
+{
+    if( connection.busy || shuttingDown_ || !HasFullRequest(connection) )
+    {
+        return;
+    }
+
+    const uint32_t size = AnnouncedSize(connection.input);
+    jobs_.Push({ id, connection.input.substr(HeaderSize, size), Clock::now() });
+    connection.input.erase(0, HeaderSize + size);
+    connection.busy = true;
+    ++inFlight_;
+}
+
+void Server::CollectCompletions()
+{
+    uint64_t counter;
+    [[maybe_unused]] auto read = ::read(wakeUp_.Get(), &counter, sizeof(counter));
+
+    std::vector<Completion> completions;
+    {
+        std::lock_guard lock(completionsMutex_);
+        completions.swap(completions_);
+    }
+
+    for( auto& completion : completions )
+    {
+        --inFlight_;
+        const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - completion.received);
+        latencies_.Add(latency);
+
+        auto found = connections_.find(completion.connectionId);
+        if( found == connections_.end() )
+        {
+            continue; // клиент ушел, не дождавшись ответа
+        }
+        auto& connection = found->second;
+        const uint32_t size = htonl(static_cast<uint32_t>(completion.response.size()));
+        connection.output.append(reinterpret_cast<char const*>(&size), HeaderSize);
+        connection.output += completion.response;
+        connection.busy = false;
+
+        Dispatch(completion.connectionId, connection);
+        Flush(completion.connectionId, connection); // заодно возвращает EPOLLIN, если следующий запрос ушел в работу
+        CloseIfDone(completion.connectionId, connection);
+    }
+}
+
+void Server::Flush(uint64_t id, Connection& connection)
+{
+    size_t written = 0;
+    while( written < connection.output.size() )
+    {
+        const ssize_t size = ::send(connection.fd.Get(), connection.output.data() + written,
+                                    connection.output.size() - written, MSG_NOSIGNAL);
+        if( size < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            if( errno != EAGAIN && errno != EWOULDBLOCK )
+            {
+                connection.output.clear(); // писать больше некуда
+                connection.peerClosed = true;
+                written = 0;
+            }
+            break;
+        }
+        written += size;
+    }
+    connection.output.erase(0, written);
+    UpdateEvents(id, connection);
+}
+
+void Server::UpdateEvents(uint64_t id, Connection& connection)
+{
+    // После EOF читать нечего, а EPOLLIN на закрытом сокете срабатывал бы в каждом epoll_wait, пока
+    // запрос в работе. Если и писать нечего, дескриптор убирается из epoll: EPOLLHUP не маскируется
+    uint32_t events = 0;
+    if( !connection.peerClosed && !HasFullRequest(connection) )
+    {
+        events |= EPOLLIN;
+    }
+    if( !connection.output.empty() )
+    {
+        events |= EPOLLOUT;
+    }
+    if( events == connection.events )
+    {
+        return;
+    }
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = id;
+    const int operation = events == 0 ? EPOLL_CTL_DEL : connection.events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    ::epoll_ctl(epoll_.Get(), operation, connection.fd.Get(), &event);
+    connection.events = events;
+}
+
+bool Server::CloseIfDone(uint64_t id, Connection& connection)
+{
+    if( !connection.peerClosed || connection.busy || !connection.output.empty() )
+    {
+        return false;
+    }
+    connections_.erase(id); // дескриптор закроется и сам удалится из epoll
+    return true;
+}
+
+void Server::BeginShutdown()
+{
+    signalfd_siginfo info;
+    [[maybe_unused]] auto read = ::read(signals_.Get(), &info, sizeof(info));
+
+    std::cerr << "lab1c: shutting down, " << inFlight_ << " request(s) in flight" << std::endl;
+    shuttingDown_ = true;
+    ::epoll_ctl(epoll_.Get(), EPOLL_CTL_DEL, listener_.Get(), nullptr);
+    listener_ = FileDescriptor();
+}
+
+void Server::PrintLatencies() const
+{
+    if( latencies_.Count() == 0 )
+    {
+        std::cerr << "lab1c: no requests served" << std::endl;
+        return;
+    }
+
+    std::cerr << "lab1c: " << latencies_.Count() << " request(s), latency us:"
+              << " p50 " << latencies_.Percentile(0.50)
+              << " p90 " << latencies_.Percentile(0.90)
+              << " p99 " << latencies_.Percentile(0.99)
+              << " max " << latencies_.Max() << std::endl;
+}
+
+} // namespace anonymous
+
+void RunServer(ServerOptions const& options)
+{
+    Server server(options);
+    server.Run();
+}
+
+} // namespace compilers
+} // namespace tusur
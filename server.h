@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+#include <lab_one.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+struct ServerOptions
+{
+    std::string socketPath;
+    unsigned workerCount = 0; // 0 - по числу ядер
+    CompileOptions compileOptions;
+};
+
+///@brief Запустить сервер компиляции на Unix domain socket
+///
+/// Запрос и ответ - 4 байта длины в сетевом порядке байт и следом данные этой длины.
+/// В запросе одно выражение, в ответе отчет в том же виде, что печатает lab1c.
+/// Запросы одного соединения обрабатываются по очереди, разные соединения - параллельно. Пока запрос
+/// в работе, следующий читается только до своего конца. Запрос длиннее 16 МБ закрывает соединение.
+/// Работает до SIGINT или SIGTERM: новые соединения перестают приниматься, начатые запросы
+/// дорабатываются и отправляются, после чего выводится статистика задержек. Задержки копятся в гистограмме
+/// с погрешностью до 3%, так что память сервера не растет с числом запросов.
+void RunServer(ServerOptions const& options);
+
+} // namespace compilers
+} // namespace tusur
@@ -0,0 +1,142 @@
+#include <stats.h>
+
+#ifdef LAB1C_STATS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace tusur
+{
+namespace compilers
+{
+
+namespace
+{
+
+// Не в Stats, так как operator new вызывается и до создания, и после разрушения статических объектов
+constinit std::atomic<bool> countAllocations = false;
+constinit std::atomic<std::uint64_t> allocations = 0;
+constinit std::atomic<std::uint64_t> allocatedBytes = 0;
+
+void CountAllocation(std::size_t size)
+{
+    // Без --stats аллокации не платят за атомарные счетчики
+    if( !countAllocations.load(std::memory_order_relaxed) )
+    {
+        return;
+    }
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+std::string Nanoseconds(Stats::Duration duration)
+{
+    return std::to_string(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+template<typename Map, typename KeyToString>
+std::string MapToJson(Map const& map, KeyToString&& keyToString)
+{
+    std::string json = "{";
+    for( auto const& [key, value] : map )
+    {
+        if( value == 0 )
+        {
+            continue;
+        }
+        if( json.size() > 1 )
+        {
+            json += ", ";
+        }
+        json += "\"" + keyToString(key) + "\": " + std::to_string(value);
+    }
+    return json + "}";
+}
+
+} // namespace anonymous
+
+Stats& CurrentStats()
+{
+    thread_local Stats stats;
+    return stats;
+}
+
+void MergeStats(Stats& into, Stats const& from)
+{
+    into.bytesProcessed += from.bytesProcessed;
+    for( auto const& [state, count] : from.transitions )
+    {
+        into.transitions[state] += count;
+    }
+    for( size_t type = 0; type < into.lexemes.size(); ++type )
+    {
+        into.lexemes[type] += from.lexemes[type];
+    }
+    into.generateCodeOnceCalls += from.generateCodeOnceCalls;
+    into.peakCodeStack = std::max(into.peakCodeStack, from.peakCodeStack);
+    into.peakOpStack = std::max(into.peakOpStack, from.peakOpStack);
+    into.registersUsed = std::max(into.registersUsed, from.registersUsed);
+    into.reading += from.reading;
+    into.automaton += from.automaton;
+    into.codegen += from.codegen;
+    into.output += from.output;
+}
+
+void EnableAllocationCounting()
+{
+    countAllocations.store(true, std::memory_order_relaxed);
+}
+
+std::string StatsToJson(Stats const& stats)
+{
+    auto asIs = [](std::string const& name){ return name; };
+    auto lexemeName = [](int type){ return LexemeTypeToString(static_cast<LexemeType>(type)); };
+    std::map<int, std::uint64_t> lexemes;
+    for( size_t type = 0; type < stats.lexemes.size(); ++type )
+    {
+        lexemes[type] = stats.lexemes[type];
+    }
+
+    return "{\n"
+           "  \"bytes_processed\": " + std::to_string(stats.bytesProcessed) + ",\n"
+           "  \"transitions\": " + MapToJson(stats.transitions, asIs) + ",\n"
+           "  \"lexemes\": " + MapToJson(lexemes, lexemeName) + ",\n"
+           "  \"generate_code_once_calls\": " + std::to_string(stats.generateCodeOnceCalls) + ",\n"
+           "  \"peak_code_stack\": " + std::to_string(stats.peakCodeStack) + ",\n"
+           "  \"peak_op_stack\": " + std::to_string(stats.peakOpStack) + ",\n"
+           "  \"registers_used\": " + std::to_string(stats.registersUsed) + ",\n"
+           "  \"allocations\": " + std::to_string(allocations.load()) + ",\n"
+           "  \"allocated_bytes\": " + std::to_string(allocatedBytes.load()) + ",\n"
+           "  \"time_ns\": {"
+               "\"reading\": " + Nanoseconds(stats.reading) + ", "
+               "\"automaton\": " + Nanoseconds(stats.automaton) + ", "
+               "\"codegen\": " + Nanoseconds(stats.codegen) + ", "
+               "\"output\": " + Nanoseconds(stats.output) + "}\n"
+           "}\n";
+}
+
+} // namespace compilers
+} // namespace tusur
+
+void* operator new(std::size_t size)
+{
+    tusur::compilers::CountAllocation(size);
+    if( void* memory = std::malloc(size ? size : 1) )
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+#endif // LAB1C_STATS
@@ -0,0 +1,87 @@
+#pragma once
+
+// Счетчики и таймеры для --stats. Собираются только при сборке с LAB1C_STATS,
+// иначе макросы ниже раскрываются в ничто и не стоят ничего.
+
+#ifdef LAB1C_STATS
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include <compilation.h>
+
+namespace tusur
+{
+namespace compilers
+{
+
+struct Stats
+{
+    using Duration = std::chrono::steady_clock::duration;
+
+    std::uint64_t bytesProcessed = 0;
+    std::map<std::string, std::uint64_t> transitions; // переходы из состояния по его имени
+    std::array<std::uint64_t, Identifier + 1> lexemes{}; // завершенные лексемы по LexemeType
+    std::uint64_t generateCodeOnceCalls = 0; // свернутых операций с присваиванием, без --reassociate и --target reg
+    std::size_t peakCodeStack = 0;
+    std::size_t peakOpStack = 0;
+    std::size_t registersUsed = 0;
+
+    Duration reading{};
+    Duration automaton{};
+    Duration codegen{};
+    Duration output{};
+};
+
+///@brief Статистика текущего потока. У потоков сервера и чтения файлов она своя
+Stats& CurrentStats();
+
+///@brief Прибавить статистику другого потока: счетчики и время складываются, пики берутся наибольшие
+void MergeStats(Stats& into, Stats const& from);
+
+///@brief Начать считать аллокации. Без этого замененный operator new только проверяет флаг
+void EnableAllocationCounting();
+
+///@brief Статистика в виде JSON вместе со счетчиками аллокаций всех потоков
+std::string StatsToJson(Stats const& stats);
+
+// Прибавляет время жизни объекта к указанной длительности
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Stats::Duration& target)
+        : target_(target)
+        , start_(std::chrono::steady_clock::now())
+    {}
+    ~ScopedTimer()
+    {
+        target_ += std::chrono::steady_clock::now() - start_;
+    }
+
+private:
+    Stats::Duration& target_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace compilers
+} // namespace tusur
+
+#define LAB1C_STATS_DO(...) do { __VA_ARGS__; } while( false )
+#define LAB1C_STATS_MAX(field, value) \
+    LAB1C_STATS_DO( auto& f = ::tusur::compilers::CurrentStats().field; f = std::max<decltype(f + 0)>(f, value) )
+#define LAB1C_STATS_CONCAT_(a, b) a##b
+#define LAB1C_STATS_CONCAT(a, b) LAB1C_STATS_CONCAT_(a, b)
+#define LAB1C_STATS_TIMER(field) \
+    ::tusur::compilers::ScopedTimer LAB1C_STATS_CONCAT(statsTimer, __LINE__)(::tusur::compilers::CurrentStats().field)
+
+#else
+
+#define LAB1C_STATS_DO(...) do {} while( false )
+#define LAB1C_STATS_MAX(field, value) do {} while( false )
+#define LAB1C_STATS_TIMER(field)
+
+#endif // LAB1C_STATS